@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -48,6 +49,10 @@
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
 
+/* How long to wait for a command completion interrupt before
+   giving up on the disk, in milliseconds. */
+#define DISK_TIMEOUT_MS 30000
+
 /* An ATA device. */
 struct disk
   {
@@ -124,7 +129,7 @@ disk_init (void)
         default:
           NOT_REACHED ();
         }
-      lock_init (&c->lock);
+      lock_init_named (&c->lock, c->name);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
 
@@ -226,12 +231,16 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer)
 
   c = d->channel;
   lock_acquire (&c->lock);
+  TRACE (TRACE_DISK_READ, sec_no, (c - channels) * 2 + d->dev_no);
   select_sector (d, sec_no);
   issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
+  if (!sema_down_timeout (&c->completion_wait,
+                          timer_ms_to_ticks (DISK_TIMEOUT_MS)))
+    PANIC ("%s: disk read timed out, sector=%"PRDSNu, d->name, sec_no);
   if (!wait_while_busy (d))
     PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
   input_sector (c, buffer);
+  TRACE (TRACE_DISK_DONE, sec_no, 0);
   d->read_cnt++;
   lock_release (&c->lock);
 }
@@ -251,12 +260,16 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer)
 
   c = d->channel;
   lock_acquire (&c->lock);
+  TRACE (TRACE_DISK_WRITE, sec_no, (c - channels) * 2 + d->dev_no);
   select_sector (d, sec_no);
   issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
   if (!wait_while_busy (d))
     PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
   output_sector (c, buffer);
-  sema_down (&c->completion_wait);
+  if (!sema_down_timeout (&c->completion_wait,
+                          timer_ms_to_ticks (DISK_TIMEOUT_MS)))
+    PANIC ("%s: disk write timed out, sector=%"PRDSNu, d->name, sec_no);
+  TRACE (TRACE_DISK_DONE, sec_no, 0);
   d->write_cnt++;
   lock_release (&c->lock);
 }
@@ -94,6 +94,16 @@ serial_init_queue (void)
   intr_set_level (old_level);
 }
 
+/* Sends string S to the serial port only, bypassing the console.
+   Used for bulk machine-readable output, such as trace and
+   profile dumps, that would be slow to scroll by on VGA. */
+void
+serial_puts (const char *s)
+{
+  while (*s != '\0')
+    serial_putc (*s++);
+}
+
 /* Sends BYTE to the serial port. */
 void
 serial_putc (uint8_t byte)
@@ -5,6 +5,7 @@
 
 void serial_init_queue (void);
 void serial_putc (uint8_t);
+void serial_puts (const char *);
 void serial_flush (void);
 void serial_notify (void);
 
@@ -0,0 +1,254 @@
+#include "devices/timeout.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+
+/* Pending timeouts are kept in a hierarchical timing wheel, as
+   in the classic BSD and Linux timer code.  There are
+   WHEEL_LEVELS wheels of WHEEL_SIZE slots each.  Level 0 has one
+   slot per tick and holds the timeouts due within WHEEL_SIZE
+   ticks; each slot of level L covers WHEEL_SIZE**L ticks.
+
+   Adding or cancelling a timeout is O(1).  Each tick empties one
+   slot of level 0.  Every WHEEL_SIZE ticks, one slot of level 1
+   is "cascaded": its timeouts are redistributed into level 0,
+   and so on up the levels, so each timeout is moved at most
+   WHEEL_LEVELS - 1 times before it expires.
+
+   Timeouts further away than the wheels reach are parked in the
+   last slot of the highest level and cascaded back into it until
+   they come within reach. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_SPAN (1LL << (WHEEL_BITS * WHEEL_LEVELS))
+
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+
+/* Next tick to process.  All timeouts due before it have been
+   moved to `expired'. */
+static int64_t next_tick;
+
+/* Timeouts that are due but whose functions have not been
+   called yet. */
+static struct list expired;
+
+/* Statistics. */
+static long long added_cnt;     /* # of timeout_add() calls. */
+static long long fired_cnt;     /* # of functions called. */
+static long long cancelled_cnt; /* # of pending timeouts cancelled. */
+static long long cascaded_cnt;  /* # of timeouts moved down a level. */
+static int pending_cnt;         /* # of timeouts currently pending. */
+static int max_pending;         /* Highest value of pending_cnt. */
+
+static void wheel_insert (struct timeout *);
+static void cascade (int level, int slot);
+static void run_expired (void);
+
+/* Initializes the callout wheel.  NOW is the current timer
+   tick. */
+void
+timeout_init (int64_t now)
+{
+  int level, slot;
+
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    for (slot = 0; slot < WHEEL_SIZE; slot++)
+      list_init (&wheel[level][slot]);
+  list_init (&expired);
+  next_tick = now + 1;
+}
+
+/* Arranges for FUNC to be called with AUX once TICKS timer ticks
+   have passed, or at the next tick if TICKS is not positive.  T
+   must not already be pending.  May be called from an interrupt
+   handler or a timeout function. */
+void
+timeout_add (struct timeout *t, timeout_func *func, void *aux, int64_t ticks)
+{
+  enum intr_level old_level;
+
+  ASSERT (t != NULL);
+  ASSERT (func != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (!t->pending);
+  t->func = func;
+  t->aux = aux;
+  t->expires = next_tick - 1 + (ticks > 0 ? ticks : 1);
+  t->pending = true;
+  wheel_insert (t);
+
+  added_cnt++;
+  if (++pending_cnt > max_pending)
+    max_pending = pending_cnt;
+  intr_set_level (old_level);
+}
+
+/* Cancels T if it is pending.  Returns true if T was cancelled,
+   false if it was never added or its function has already been
+   called or is running now. */
+bool
+timeout_cancel (struct timeout *t)
+{
+  enum intr_level old_level = intr_disable ();
+  bool cancelled = t->pending;
+
+  if (cancelled)
+    {
+      list_remove (&t->elem);
+      t->pending = false;
+      pending_cnt--;
+      cancelled_cnt++;
+    }
+  intr_set_level (old_level);
+  return cancelled;
+}
+
+/* Returns true if T has been added and has not yet been called
+   or cancelled. */
+bool
+timeout_pending (const struct timeout *t)
+{
+  return t->pending;
+}
+
+/* Advances the wheel through tick NOW, moving every timeout that
+   is due onto the expired list.  Called by the timer with
+   interrupts off, once per tick or once after several ticks
+   were skipped.  From an interrupt handler, arranges for the
+   expired functions to be called when the interrupt returns;
+   otherwise they are called after the next timer interrupt. */
+void
+timeout_run (int64_t now)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (; next_tick <= now; next_tick++)
+    {
+      int slot = next_tick & WHEEL_MASK;
+      int level;
+
+      /* Entering a new round of a level: bring the next slot of
+         the level above down into it. */
+      for (level = 1; slot == 0 && level < WHEEL_LEVELS; level++)
+        {
+          slot = (next_tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+          cascade (level, slot);
+        }
+
+      slot = next_tick & WHEEL_MASK;
+      while (!list_empty (&wheel[0][slot]))
+        list_push_back (&expired, list_pop_front (&wheel[0][slot]));
+    }
+
+  if (!list_empty (&expired) && intr_context ())
+    intr_raise_softirq (run_expired);
+}
+
+/* Returns the earliest tick at which a timeout may expire, or
+   INT64_MAX if none is pending.  The answer errs on the early
+   side, since a cascade may bring a timeout down to level 0.
+   Interrupts must be off. */
+int64_t
+timeout_next (void)
+{
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!list_empty (&expired))
+    return next_tick - 1;
+  if (pending_cnt == 0)
+    return INT64_MAX;
+
+  for (i = 0; i < WHEEL_SIZE; i++)
+    {
+      int64_t tick = next_tick + i;
+
+      if (!list_empty (&wheel[0][tick & WHEEL_MASK])
+          || (i > 0 && (tick & WHEEL_MASK) == 0))
+        return tick;
+    }
+  NOT_REACHED ();
+}
+
+/* Prints callout statistics. */
+void
+timeout_print_stats (void)
+{
+  printf ("Timeouts: %lld added, %lld fired, %lld cancelled, "
+          "%lld cascaded, %d pending, %d max pending\n",
+          added_cnt, fired_cnt, cancelled_cnt, cascaded_cnt,
+          pending_cnt, max_pending);
+}
+
+/* Puts T into the wheel slot for its expiry time. */
+static void
+wheel_insert (struct timeout *t)
+{
+  int64_t delta = t->expires - next_tick;
+  int64_t expires = t->expires;
+  int level;
+
+  if (delta < 0)
+    {
+      /* Already due: process it with the next tick. */
+      expires = next_tick;
+      delta = 0;
+    }
+  else if (delta >= WHEEL_SPAN)
+    {
+      expires = next_tick + WHEEL_SPAN - 1;
+      delta = WHEEL_SPAN - 1;
+    }
+
+  for (level = 0; delta >= 1LL << (WHEEL_BITS * (level + 1)); level++)
+    continue;
+  list_push_back (&wheel[level][(expires >> (WHEEL_BITS * level))
+                                & WHEEL_MASK],
+                  &t->elem);
+}
+
+/* Redistributes the timeouts in SLOT of LEVEL into the levels
+   below. */
+static void
+cascade (int level, int slot)
+{
+  struct list *list = &wheel[level][slot];
+  struct list moving;
+
+  list_init (&moving);
+  while (!list_empty (list))
+    list_push_back (&moving, list_pop_front (list));
+  while (!list_empty (&moving))
+    {
+      wheel_insert (list_entry (list_pop_front (&moving),
+                                struct timeout, elem));
+      cascaded_cnt++;
+    }
+}
+
+/* Softirq: calls the functions of the expired timeouts, with
+   interrupts on. */
+static void
+run_expired (void)
+{
+  enum intr_level old_level = intr_disable ();
+
+  while (!list_empty (&expired))
+    {
+      struct timeout *t = list_entry (list_pop_front (&expired),
+                                      struct timeout, elem);
+
+      t->pending = false;
+      pending_cnt--;
+      fired_cnt++;
+      intr_set_level (old_level);
+      t->func (t->aux);
+      intr_disable ();
+    }
+  intr_set_level (old_level);
+}
@@ -0,0 +1,38 @@
+#ifndef DEVICES_TIMEOUT_H
+#define DEVICES_TIMEOUT_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel callouts: functions called once a given number of timer
+   ticks has passed.
+
+   A callout is a `struct timeout' owned by the caller, usually
+   embedded in a larger structure, so adding one never allocates
+   memory and may be done from an interrupt handler.  The
+   function is called with interrupts on, just after the timer
+   interrupt in which it expired returns, on whatever thread the
+   interrupt happened to interrupt.  It therefore must not sleep,
+   but it may add timeouts, including its own. */
+typedef void timeout_func (void *aux);
+
+struct timeout
+  {
+    struct list_elem elem;      /* Wheel slot or expired list. */
+    timeout_func *func;         /* Function to call. */
+    void *aux;                  /* Argument for FUNC. */
+    int64_t expires;            /* Tick at which to call FUNC. */
+    bool pending;               /* Added and not yet called or cancelled. */
+  };
+
+void timeout_init (int64_t now);
+void timeout_add (struct timeout *, timeout_func *, void *aux, int64_t ticks);
+bool timeout_cancel (struct timeout *);
+bool timeout_pending (const struct timeout *);
+
+void timeout_run (int64_t now);
+int64_t timeout_next (void);
+void timeout_print_stats (void);
+
+#endif /* devices/timeout.h */
@@ -1,29 +1,84 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/prof.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "devices/timeout.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
+/* 8254 input clock frequency, in Hz. */
+#define PIT_HZ 1193180
+
+/* Sub-tick sleeps shorter than this many nanoseconds spin on the
+   time stamp counter, because blocking would take longer. */
+#define PRECISE_SPIN_NS 20000
+
 /* Number of timer ticks since OS booted. */
-static int64_t ticks;
+static volatile int64_t ticks;
+
+/* List of threads blocked in timer_sleep(), ordered by
+   ascending wakeup_tick so that timer_interrupt() only has to
+   look at the front. */
+static struct list sleep_list;
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* 8254 input clock cycles per timer tick.
+   Initialized by timer_init(). */
+static uint16_t pit_counts_per_tick;
+
+/* Time stamp counter frequency in Hz, or 0 before
+   timer_calibrate().  TSC_BASE is the counter's value when
+   `ticks' was TSC_BASE_TICKS. */
+static uint64_t tsc_hz;
+static uint64_t tsc_base;
+static int64_t tsc_base_ticks;
+
+/* Sub-tick sleeps.  Threads sleeping for less than a tick wait on
+   precise_list, ordered by ascending wakeup_ns.  If one of them
+   must wake up before the next tick, counter 0 is switched to a
+   one-shot that fires at its deadline, and when that fires, to a
+   one-shot for the rest of the tick, so that `ticks' is still
+   advanced on time.  This is called splitting the tick. */
+static struct list precise_list;
+static bool split_active;       /* Current tick is split. */
+static uint32_t split_counts;   /* Cycles from armed one-shot to tick. */
+
+/* Tickless idle.  While only the idle thread can run, counter 0
+   is switched from a periodic rate generator to a one-shot timer
+   that fires at the next sleep deadline, and `ticks' is caught up
+   when the CPU wakes up again. */
+bool timer_tickless;
+static int64_t oneshot_ticks;   /* Ticks covered by armed one-shot, or 0. */
+static long long skipped_ticks; /* # of timer interrupts avoided. */
+
 /* Interrupts per second, written only by timer_init */
 uint16_t TIMER_FREQ = 0;
 
 static intr_handler_func timer_interrupt;
+static bool wakeup_less (const struct list_elem *, const struct list_elem *,
+                         void *aux);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
+static void pit_set_periodic (void);
+static void pit_set_oneshot (uint16_t count);
+static uint16_t pit_remaining (void);
+static void precise_sleep (int64_t deadline);
+static void arm_precise (uint32_t remaining);
+static bool wakeup_ns_less (const struct list_elem *,
+                            const struct list_elem *, void *aux);
+static void wake_sleepers (void);
+static void catch_up (int64_t elapsed);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
@@ -38,12 +93,12 @@ timer_init (const uint16_t timer_freq)
 
   /* 8254 input frequency divided by TIMER_FREQ, rounded to
      nearest. */
-  uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-  outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-  outb (0x40, count & 0xff);
-  outb (0x40, count >> 8);
+  pit_counts_per_tick = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+  pit_set_periodic ();
 
+  list_init (&sleep_list);
+  list_init (&precise_list);
+  timeout_init (ticks);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -79,15 +134,39 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  /* Measure the time stamp counter against a tenth of a second of
+     timer ticks. */
+  {
+    int64_t tick_cnt = TIMER_FREQ / 10 > 2 ? TIMER_FREQ / 10 : 2;
+    int64_t start = ticks;
+    uint64_t tsc;
+
+    while (ticks == start)
+      barrier ();
+    start = ticks;
+    tsc = rdtsc ();
+    while (ticks < start + tick_cnt)
+      barrier ();
+
+    tsc_base = rdtsc ();
+    tsc_base_ticks = start + tick_cnt;
+    tsc_hz = (tsc_base - tsc) * TIMER_FREQ / tick_cnt;
+  }
 }
 
 /* Returns the number of timer ticks since the OS booted. */
 int64_t
 timer_ticks (void)
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
+  int64_t t;
+
+  /* Loading 64 bits takes two instructions, so the timer
+     interrupt may change `ticks' halfway through.  Reading until
+     two loads agree is cheaper than turning interrupts off. */
+  do
+    t = ticks;
+  while (t != ticks);
   barrier ();
   return t;
 }
@@ -100,15 +179,95 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
-/* Suspends execution for approximately TICKS timer ticks. */
+/* Returns the number of nanoseconds since the OS booted.  The
+   clock is monotonic.  Once timer_calibrate() has run, it is read
+   from the time stamp counter, so its resolution is far finer
+   than a timer tick. */
+int64_t
+timer_nanos (void)
+{
+  uint64_t cycles;
+
+  if (tsc_hz == 0)
+    return timer_ticks () * (1000000000 / TIMER_FREQ);
+
+  cycles = rdtsc () - tsc_base;
+  return (tsc_base_ticks * (1000000000 / TIMER_FREQ)
+          + cycles / tsc_hz * 1000000000
+          + cycles % tsc_hz * 1000000000 / tsc_hz);
+}
+
+/* Returns the frequency of the time stamp counter in Hz, or 0 if
+   the timer has not been calibrated yet. */
+uint64_t
+timer_tsc_hz (void)
+{
+  return tsc_hz;
+}
+
+/* Suspends execution for approximately TICKS timer ticks.
+
+   The calling thread is blocked and put on sleep_list until
+   timer_interrupt() finds that its wakeup tick has passed, so a
+   sleeping thread does not consume any CPU time. */
 void
 timer_sleep (int64_t ticks)
 {
-  int64_t start = timer_ticks ();
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks)
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  old_level = intr_disable ();
+  cur->wakeup_tick = timer_ticks () + ticks;
+  list_insert_ordered (&sleep_list, &cur->sleep_elem, wakeup_less, NULL);
+  thread_block ();
+  intr_set_level (old_level);
+}
+
+/* Blocks the current thread, which must have interrupts off,
+   until either some other piece of code unblocks it or `ticks'
+   reaches DEADLINE, whichever comes first.  Returns true if the
+   deadline woke the thread, false otherwise.
+
+   The caller may have put the current thread's `elem' on a wait
+   queue, as sema_down_timeout() does.  If the deadline comes
+   first, timer_interrupt() removes `elem' from that queue in the
+   same atomic step as it unblocks the thread, so the waker can
+   never find a thread there that is no longer blocked. */
+bool
+timer_block_until (int64_t deadline)
+{
+  struct thread *cur = thread_current ();
+  bool timed_out;
+
+  ASSERT (!intr_context ());
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  cur->wakeup_tick = deadline;
+  cur->timed_wait = true;
+  list_insert_ordered (&sleep_list, &cur->sleep_elem, wakeup_less, NULL);
+  thread_block ();
+
+  /* wake_sleepers() clears `timed_wait' when it times us out.
+     Otherwise we are still on sleep_list. */
+  timed_out = !cur->timed_wait;
+  if (!timed_out)
+    {
+      cur->timed_wait = false;
+      list_remove (&cur->sleep_elem);
+    }
+  return timed_out;
+}
+
+/* Returns the number of timer ticks in MS milliseconds, rounded
+   up so that a timed wait never expires early. */
+int64_t
+timer_ms_to_ticks (int64_t ms)
+{
+  return DIV_ROUND_UP (ms * TIMER_FREQ, 1000);
 }
 
 /* Suspends execution for approximately MS milliseconds. */
@@ -132,20 +291,326 @@ timer_nsleep (int64_t ns)
   real_time_sleep (ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, replaces the periodic tick by
+   a single interrupt at the earliest sleep deadline, or as late
+   as counter 0 allows if nobody sleeps.  Under -mlfqs the
+   interrupt also comes no later than the next whole second, so
+   that the once-per-second statistics are still updated on time.
+
+   A time slice never needs to expire here: the idle thread only
+   runs when no other thread is ready. */
+void
+timer_idle_enter (void)
+{
+  int64_t max_ticks = 0xffff / pit_counts_per_tick;
+  int64_t delta = max_ticks;
+  uint16_t count;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || oneshot_ticks != 0 || split_active)
+    return;
+
+  if (!list_empty (&sleep_list))
+    delta = list_entry (list_front (&sleep_list),
+                        struct thread, sleep_elem)->wakeup_tick - ticks;
+  if (!list_empty (&precise_list))
+    {
+      /* Stop a tick short: the tick at which it is interrupted
+         splits itself for the rest. */
+      int64_t ns = list_entry (list_front (&precise_list),
+                               struct thread, sleep_elem)->wakeup_ns;
+      int64_t precise = (ns - timer_nanos ()) / (1000000000 / TIMER_FREQ);
+      if (precise < delta)
+        delta = precise;
+    }
+  if (timeout_next () - ticks < delta)
+    delta = timeout_next () - ticks;
+  if (thread_mlfqs && TIMER_FREQ - ticks % TIMER_FREQ < delta)
+    delta = TIMER_FREQ - ticks % TIMER_FREQ;
+  if (delta > max_ticks)
+    delta = max_ticks;
+
+  /* The periodic tick is at least as good for the very next
+     tick. */
+  if (delta <= 1)
+    return;
+
+  oneshot_ticks = delta;
+  count = delta * pit_counts_per_tick;
+  pit_set_oneshot (count);
+}
+
+/* Called by the scheduler, with interrupts off, when the idle
+   thread gives up the CPU.  If the CPU was woken by another
+   interrupt before the one-shot fired, reads how far counter 0
+   got, catches `ticks' up by the number of whole ticks that
+   elapsed and returns to the periodic tick.  The partial tick in
+   progress is lost. */
+void
+timer_idle_exit (void)
+{
+  uint16_t armed, remaining;
+  int64_t elapsed;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (oneshot_ticks == 0)
+    return;
+
+  remaining = pit_remaining ();
+  armed = oneshot_ticks * pit_counts_per_tick;
+  if (remaining <= armed)
+    elapsed = (armed - remaining) / pit_counts_per_tick;
+  else
+    {
+      /* The count wrapped past zero, so the one-shot interrupt is
+         pending and will account for the last tick itself. */
+      elapsed = oneshot_ticks - 1;
+    }
+
+  oneshot_ticks = 0;
+  pit_set_periodic ();
+  catch_up (elapsed);
+  arm_precise (pit_counts_per_tick);
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void)
 {
   printf ("Timer: %d interrupts per second\n", TIMER_FREQ);
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  if (timer_tickless)
+    printf ("Timer: %lld interrupts avoided by tickless idle\n",
+            skipped_ticks);
+  if (tsc_hz != 0)
+    printf ("Timer: TSC runs at %'"PRIu64" Hz\n", tsc_hz);
 }
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
+  /* A one-shot programmed by arm_precise() to split the current
+     tick has expired: program the rest of the tick, then wake up
+     the sub-tick sleepers that are due.  That may split the rest
+     of the tick again. */
+  if (split_active && split_counts != 0)
+    {
+      uint32_t rest = split_counts;
+
+      split_counts = 0;
+      pit_set_oneshot (rest);
+      wake_sleepers ();
+      arm_precise (rest);
+      return;
+    }
+
+  /* The last part of a split tick has expired. */
+  if (split_active)
+    {
+      split_active = false;
+      pit_set_periodic ();
+    }
+
+  /* A one-shot programmed by timer_idle_enter() has expired:
+     account for the ticks that were skipped and go back to the
+     periodic tick. */
+  if (oneshot_ticks != 0)
+    {
+      int64_t skipped = oneshot_ticks - 1;
+
+      oneshot_ticks = 0;
+      pit_set_periodic ();
+      catch_up (skipped);
+    }
+
   ticks++;
+  if (prof_enabled)
+    prof_sample (args);
+  timeout_run (ticks);
+  wake_sleepers ();
   thread_tick ();
+  arm_precise (pit_counts_per_tick);
+}
+
+/* Programs counter 0 to interrupt once, COUNT input clock cycles
+   from now.  COUNT must be nonzero. */
+static void
+pit_set_oneshot (uint16_t count)
+{
+  ASSERT (count != 0);
+
+  outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+  outb (0x40, count & 0xff);
+  outb (0x40, count >> 8);
+}
+
+/* Returns the number of input clock cycles until counter 0 next
+   reaches zero.  Right after counter 0 was programmed, the value
+   may not have been loaded yet, so callers that just programmed
+   it should use the count they wrote instead. */
+static uint16_t
+pit_remaining (void)
+{
+  uint16_t count;
+
+  outb (0x43, 0x00);    /* CW: counter 0, latch count. */
+  count = inb (0x40);
+  count |= inb (0x40) << 8;
+  return count;
+}
+
+/* Programs counter 0 to interrupt every pit_counts_per_tick input
+   clock cycles. */
+static void
+pit_set_periodic (void)
+{
+  outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+  outb (0x40, pit_counts_per_tick & 0xff);
+  outb (0x40, pit_counts_per_tick >> 8);
+}
+
+/* Advances `ticks' by ELAPSED ticks that passed without a timer
+   interrupt while the CPU was idle, and wakes up any thread whose
+   sleep ended in the meantime.  Interrupts must be off. */
+static void
+catch_up (int64_t elapsed)
+{
+  if (elapsed <= 0)
+    return;
+
+  ticks += elapsed;
+  skipped_ticks += elapsed;
+  thread_idle_ticks (elapsed);
+  timeout_run (ticks);
+  wake_sleepers ();
+}
+
+/* Wakes up every sleeping thread whose deadline has passed.
+   The list is ordered, so we can stop at the first thread that
+   must keep sleeping.  Interrupts must be off.
+
+   A thread in a timed wait that was already woken by its waker
+   is skipped; it takes itself off the list when it runs. */
+static void
+wake_sleepers (void)
+{
+  struct list_elem *e = list_begin (&sleep_list);
+
+  while (e != list_end (&sleep_list))
+    {
+      struct thread *t = list_entry (e, struct thread, sleep_elem);
+      if (t->wakeup_tick > ticks)
+        break;
+      if (t->status != THREAD_BLOCKED)
+        {
+          e = list_next (e);
+          continue;
+        }
+      e = list_remove (e);
+      if (t->timed_wait)
+        {
+          list_remove (&t->elem);
+          t->timed_wait = false;
+        }
+      thread_unblock (t);
+    }
+
+  if (!list_empty (&precise_list))
+    {
+      int64_t now = timer_nanos ();
+
+      while (!list_empty (&precise_list))
+        {
+          struct thread *t = list_entry (list_front (&precise_list),
+                                         struct thread, sleep_elem);
+          if (t->wakeup_ns > now)
+            break;
+          list_pop_front (&precise_list);
+          thread_unblock (t);
+        }
+    }
+}
+
+/* Blocks the current thread until timer_nanos() reaches DEADLINE.
+   Deadlines that are very close are busy-waited instead. */
+static void
+precise_sleep (int64_t deadline)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  if (deadline - timer_nanos () < PRECISE_SPIN_NS)
+    {
+      while (timer_nanos () < deadline)
+        barrier ();
+      return;
+    }
+
+  old_level = intr_disable ();
+  cur->wakeup_ns = deadline;
+  list_insert_ordered (&precise_list, &cur->sleep_elem, wakeup_ns_less, NULL);
+  arm_precise (pit_remaining ());
+  thread_block ();
+  intr_set_level (old_level);
+}
+
+/* If the earliest sub-tick sleeper must wake up before counter 0
+   next interrupts, which is REMAINING input clock cycles away,
+   splits the current tick at its deadline.  Does nothing while
+   the idle thread's tickless one-shot is armed.  Interrupts must
+   be off. */
+static void
+arm_precise (uint32_t remaining)
+{
+  int64_t delta;
+  uint32_t counts;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (list_empty (&precise_list) || oneshot_ticks != 0)
+    return;
+
+  delta = list_entry (list_front (&precise_list),
+                      struct thread, sleep_elem)->wakeup_ns - timer_nanos ();
+  counts = delta > 0 ? delta * PIT_HZ / 1000000000 : 0;
+  if (counts == 0)
+    counts = 1;
+  if (counts >= remaining)
+    return;
+
+  pit_set_oneshot (counts);
+  if (!split_active)
+    split_counts = 0;
+  split_counts += remaining - counts;
+  split_active = true;
+}
+
+/* Returns true if the thread owning sleep_elem A should wake up
+   from a sub-tick sleep before the thread owning sleep_elem B. */
+static bool
+wakeup_ns_less (const struct list_elem *a_, const struct list_elem *b_,
+                void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, sleep_elem);
+  const struct thread *b = list_entry (b_, struct thread, sleep_elem);
+
+  return a->wakeup_ns < b->wakeup_ns;
+}
+
+/* Returns true if the thread owning sleep_elem A should wake up
+   before the thread owning sleep_elem B. */
+static bool
+wakeup_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, sleep_elem);
+  const struct thread *b = list_entry (b_, struct thread, sleep_elem);
+
+  return a->wakeup_tick < b->wakeup_tick;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -202,11 +667,19 @@ real_time_sleep (int64_t num, int32_t denom)
          processes. */
       timer_sleep (ticks);
     }
+  else if (tsc_hz != 0)
+    {
+      /* Otherwise, block until a precise deadline on the time
+         stamp counter.  NUM / DENOM is less than a tick, so the
+         product cannot overflow. */
+      precise_sleep (timer_nanos () + num * 1000000000 / denom);
+    }
   else
     {
-      /* Otherwise, use a busy-wait loop for more accurate
-         sub-tick timing.  We scale the numerator and denominator
-         down by 1000 to avoid the possibility of overflow. */
+      /* Before the TSC is calibrated, use a busy-wait loop for
+         more accurate sub-tick timing.  We scale the numerator
+         and denominator down by 1000 to avoid the possibility of
+         overflow. */
       ASSERT (denom % 1000 == 0);
       busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
     }
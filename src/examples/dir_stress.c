@@ -5,6 +5,7 @@
 */
 
 #include <stdio.h>
+#include <string.h>
 #include <syscall.h>
 
 #define CREATORS  20   /* no of procs to concurrently create files */
@@ -12,6 +13,40 @@
 #define CYCLES   100   /* how many create/remove cycles to do */
 #define TRIES     20   /* how many tries to create duplicates */
 #define BUFSIZE   40   /* exec cmd line buffer */
+#define LOCKS     32   /* max no of kernel locks to profile */
+
+/* kernel lock profile before and after the workload (static to keep
+   them off the one page user stack) */
+static struct lockstat before[LOCKS];
+static struct lockstat after[LOCKS];
+
+/* print how much contention each kernel lock saw during the workload */
+static void print_lock_deltas(int before_cnt, int after_cnt)
+{
+  int i, j;
+
+  printf("%-15s %10s %10s %10s %10s\n",
+         "lock", "acquired", "contended", "wait", "held");
+  for (i = 0; i < after_cnt; ++i)
+  {
+    struct lockstat delta = after[i];
+
+    for (j = 0; j < before_cnt; ++j)
+      if (strcmp(before[j].name, after[i].name) == 0)
+      {
+        delta.acquire_cnt -= before[j].acquire_cnt;
+        delta.contended_cnt -= before[j].contended_cnt;
+        delta.wait_ticks -= before[j].wait_ticks;
+        delta.hold_ticks -= before[j].hold_ticks;
+        break;
+      }
+
+    if (delta.acquire_cnt != 0)
+      printf("%-15s %10lld %10lld %10lld %10lld\n",
+             delta.name, delta.acquire_cnt, delta.contended_cnt,
+             delta.wait_ticks, delta.hold_ticks);
+  }
+}
 
 int main(void)
 {
@@ -20,6 +55,11 @@ int main(void)
   int loader_pid[LOADERS];
   int exit_status = 0;
   int i, n;
+  int before_cnt = lockstat(before, LOCKS);
+  struct timespec start, end;
+  long long elapsed_us;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
 
   /* put some load on the directory */
   for (i = 0; i < LOADERS; ++i)
@@ -91,5 +131,13 @@ int main(void)
     }
   }
 
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  elapsed_us = (end.tv_sec - start.tv_sec) * 1000000LL
+    + (end.tv_nsec - start.tv_nsec) / 1000;
+  printf("dir_stress: %d tries took %lld.%06lld s\n",
+         TRIES, elapsed_us / 1000000, elapsed_us % 1000000);
+
+  print_lock_deltas(before_cnt, lockstat(after, LOCKS));
+
   return exit_status;
 }
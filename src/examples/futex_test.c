@@ -0,0 +1,97 @@
+/* pintos -v -k --fs-disk=2 --qemu -p ../examples/futex_test -a futex_test -- -f -q run futex_test
+
+   Simple tests for the futex_wait and futex_wake system calls and
+   the mutex and condition variable in lib/user/synch.h.
+
+   A process has just one thread and shares no memory with others,
+   so nobody can wake it up. These tests check the cases that need
+   no other thread: locking without contention, a futex_wait whose
+   word already changed, and waits that time out.
+  */
+
+#include <syscall.h>
+#include <stdio.h>
+#include <synch.h>
+
+static struct mutex m = MUTEX_INITIALIZER;
+static struct condvar cv = CONDVAR_INITIALIZER;
+static int word = 7;
+
+// Milliseconds since boot
+static long long now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+int main(void)
+{
+  long long start;
+  int result;
+
+  // Uncontended mutex, no system calls
+  mutex_lock(&m);
+  if (mutex_trylock(&m))
+  {
+    printf("ERROR: trylock succeeded on a locked mutex\n");
+    return -1;
+  }
+  mutex_unlock(&m);
+  if (!mutex_trylock(&m))
+  {
+    printf("ERROR: trylock failed on a free mutex\n");
+    return -1;
+  }
+  mutex_unlock(&m);
+  if (m.state != 0)
+  {
+    printf("ERROR: unlocked mutex has state %d\n", m.state);
+    return -1;
+  }
+
+  // The word does not hold the expected value, so don't sleep
+  result = futex_wait(&word, 8, -1);
+  if (result != FUTEX_MISMATCH)
+  {
+    printf("ERROR: Expected futex_wait to return at once, but got: %d\n", result);
+    return -1;
+  }
+
+  // Nobody sleeps on the word
+  result = futex_wake(&word, 1);
+  if (result != 0)
+  {
+    printf("ERROR: futex_wake woke %d threads\n", result);
+    return -1;
+  }
+
+  // Nobody wakes us, so this times out
+  start = now_ms();
+  result = futex_wait(&word, 7, 50);
+  if (result != FUTEX_TIMEDOUT)
+  {
+    printf("ERROR: Expected futex_wait to time out, but got: %d\n", result);
+    return -1;
+  }
+  // Timeouts count whole timer ticks, so allow one tick of slack
+  if (now_ms() - start < 40)
+  {
+    printf("ERROR: futex_wait timed out after %lld ms\n", now_ms() - start);
+    return -1;
+  }
+
+  // Signaling without waiters costs no system call
+  cond_signal(&cv);
+
+  mutex_lock(&m);
+  if (cond_wait_timeout(&cv, &m, 20))
+  {
+    printf("ERROR: cond_wait_timeout was signaled by nobody\n");
+    return -1;
+  }
+  mutex_unlock(&m);
+
+  printf("futex_test: OK\n");
+  return 0;
+}
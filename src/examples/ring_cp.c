@@ -0,0 +1,141 @@
+/* pintos -v -k --fs-disk=2 --qemu -p ../examples/ring_cp -a ring_cp -p ../examples/shell -a shell -- -f -q run 'ring_cp shell copy'
+
+   Copies a file twice, first with one read and one write system
+   call per block, then with the reads and writes queued on a
+   submission ring and run a batch at a time, and compares how
+   long the two took.
+
+   Small blocks make the cost of each system call stand out. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include <batch.h>
+
+#define BLOCK 512                     /* bytes per read or write */
+#define PAIRS (RING_ENTRIES / 2)      /* read+write pairs per batch */
+
+static struct ring ring;
+static char buffer[PAIRS][BLOCK];
+
+// Microseconds since boot
+static long long now_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// Creates and opens the copy, returns its fd or -1
+static int create_copy(const char* name, int size)
+{
+  remove(name);
+  if (!create(name, size))
+  {
+    printf("%s: create failed\n", name);
+    return -1;
+  }
+  return open(name);
+}
+
+// Copies size bytes from in_fd to out_fd, one system call at a time
+static bool copy_direct(int in_fd, int out_fd, int size, int* calls)
+{
+  for (int done = 0; done < size; done += BLOCK)
+  {
+    int length = (size - done < BLOCK) ? size - done : BLOCK;
+
+    if (read(in_fd, buffer[0], length) != length
+        || write(out_fd, buffer[0], length) != length)
+      return false;
+    *calls += 2;
+  }
+  return true;
+}
+
+// Copies size bytes from in_fd to out_fd, PAIRS blocks per system call
+static bool copy_batched(int in_fd, int out_fd, int size, int* calls)
+{
+  for (int done = 0; done < size; )
+  {
+    int queued = 0;
+
+    // Each write copies what the read queued just before it filled in
+    for (int i = 0; i < PAIRS && done < size; i++, done += BLOCK)
+    {
+      int length = (size - done < BLOCK) ? size - done : BLOCK;
+
+      ring_prep_read(ring_get_sqe(&ring), in_fd, buffer[i], length, length);
+      ring_prep_write(ring_get_sqe(&ring), out_fd, buffer[i], length, length);
+      queued += 2;
+    }
+
+    if (ring_submit(&ring, queued) != queued)
+      return false;
+    *calls += 1;
+
+    struct ring_cqe cqe;
+    while (ring_get_cqe(&ring, &cqe))
+      if (cqe.result != (int32_t) cqe.user_data)
+        return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  int in_fd, out_fd, size;
+  int direct_calls = 0, batched_calls = 0;
+  long long start, direct_us, batched_us;
+
+  if (argc != 3)
+  {
+    printf("usage: ring_cp OLD NEW\n");
+    return EXIT_FAILURE;
+  }
+
+  in_fd = open(argv[1]);
+  if (in_fd < 0)
+  {
+    printf("%s: open failed\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  size = filesize(in_fd);
+
+  if (!ring_init(&ring))
+  {
+    printf("ring_setup failed\n");
+    return EXIT_FAILURE;
+  }
+
+  // One system call per block
+  out_fd = create_copy(argv[2], size);
+  if (out_fd < 0)
+    return EXIT_FAILURE;
+  start = now_us();
+  if (!copy_direct(in_fd, out_fd, size, &direct_calls))
+  {
+    printf("%s: direct copy failed\n", argv[2]);
+    return EXIT_FAILURE;
+  }
+  direct_us = now_us() - start;
+  close(out_fd);
+
+  // The same, batched
+  seek(in_fd, 0);
+  out_fd = create_copy(argv[2], size);
+  if (out_fd < 0)
+    return EXIT_FAILURE;
+  start = now_us();
+  if (!copy_batched(in_fd, out_fd, size, &batched_calls))
+  {
+    printf("%s: batched copy failed\n", argv[2]);
+    return EXIT_FAILURE;
+  }
+  batched_us = now_us() - start;
+  close(out_fd);
+
+  printf("ring_cp: %d bytes in blocks of %d\n", size, BLOCK);
+  printf("direct:  %6d system calls, %8lld us\n", direct_calls, direct_us);
+  printf("batched: %6d system calls, %8lld us\n", batched_calls, batched_us);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/* pintos -v -k --fs-disk=2 --qemu -p ../examples/rw_test -a rw_test -- -f -q run rw_test
+
+   Simple tests for the pread, pwrite, readv and writev system
+   calls: positional I/O must leave the file position alone, and
+   the vectored calls must fill and drain their buffers in order.
+  */
+
+#include <syscall.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FILE_NAME "rw_test.dat"
+
+int main(void)
+{
+  char buffer[16];
+  char head[4], tail[6];
+  struct iovec iov[2];
+  int fd, result;
+
+  // Files don't grow, so make room for everything written below
+  if (!create(FILE_NAME, 10) || (fd = open(FILE_NAME)) < 0)
+  {
+    printf("ERROR: could not create %s\n", FILE_NAME);
+    return -1;
+  }
+
+  // Two buffers written with one call
+  iov[0].iov_base = "abcd";
+  iov[0].iov_len = 4;
+  iov[1].iov_base = "efghij";
+  iov[1].iov_len = 6;
+  result = writev(fd, iov, 2);
+  if (result != 10 || tell(fd) != 10)
+  {
+    printf("ERROR: writev wrote %d bytes, position %d\n", result, tell(fd));
+    return -1;
+  }
+
+  // Overwrite in the middle without moving the position
+  result = pwrite(fd, "XY", 2, 3);
+  if (result != 2 || tell(fd) != 10)
+  {
+    printf("ERROR: pwrite wrote %d bytes, position %d\n", result, tell(fd));
+    return -1;
+  }
+
+  result = pread(fd, buffer, 5, 2);
+  if (result != 5 || memcmp(buffer, "cXYfg", 5) != 0 || tell(fd) != 10)
+  {
+    printf("ERROR: pread read %d bytes, position %d\n", result, tell(fd));
+    return -1;
+  }
+
+  // Reading past the end reads nothing
+  result = pread(fd, buffer, sizeof buffer, 10);
+  if (result != 0)
+  {
+    printf("ERROR: pread at the end read %d bytes\n", result);
+    return -1;
+  }
+
+  // Scatter the file into two buffers
+  seek(fd, 0);
+  iov[0].iov_base = head;
+  iov[0].iov_len = sizeof head;
+  iov[1].iov_base = tail;
+  iov[1].iov_len = sizeof tail;
+  result = readv(fd, iov, 2);
+  if (result != 10 || memcmp(head, "abcX", 4) != 0
+      || memcmp(tail, "Yfghij", 6) != 0)
+  {
+    printf("ERROR: readv read %d bytes\n", result);
+    return -1;
+  }
+
+  // Not a file
+  if (pread(STDIN_FILENO, buffer, 1, 0) != -1 || readv(fd, iov, -1) != -1)
+  {
+    printf("ERROR: bad arguments were accepted\n");
+    return -1;
+  }
+
+  close(fd);
+  remove(FILE_NAME);
+  printf("rw_test: OK\n");
+  return 0;
+}
@@ -0,0 +1,68 @@
+/* pintos -v -k --fs-disk=2 --qemu -p ../examples/spawn_bench -a spawn_bench -p ../examples/dummy -a dummy -- -f -q run 'spawn_bench 200'
+
+   Measures how fast the kernel starts a process and collects its
+   exit status: runs 'dummy' and waits for it, over and over, and
+   reports the number of round trips per second.
+
+   Every exec inserts into the process table and every wait looks
+   up and frees a slot, so this shows what the process table costs
+   next to loading the program.
+ */
+
+#include <syscall.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define DEFAULT_ROUNDS 100
+
+// Nanoseconds since boot
+static long long now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int argc, char* argv[])
+{
+  char cmd[15];
+  int rounds = DEFAULT_ROUNDS;
+  int i;
+  long long start, elapsed;
+
+  if (argc > 2)
+  {
+    printf("Usage: %s [rounds]\n", argv[0]);
+    return -1;
+  }
+  if (argc == 2)
+    rounds = atoi(argv[1]);
+  if (rounds <= 0)
+  {
+    printf("Rounds must be positive.\n");
+    return -1;
+  }
+
+  start = now_ns();
+  for (i = 0; i < rounds; i++)
+  {
+    snprintf(cmd, 15, "dummy %i", i);
+    int pid = exec(cmd);
+    if (pid == -1)
+    {
+      printf("ERROR: exec failed after %d rounds\n", i);
+      return -1;
+    }
+    if (wait(pid) != i)
+    {
+      printf("ERROR: wrong exit status from '%s'\n", cmd);
+      return -1;
+    }
+  }
+  elapsed = now_ns() - start;
+
+  printf("spawn_bench: %d round trips in %lld ms, %lld per second\n",
+         rounds, elapsed / 1000000,
+         elapsed > 0 ? rounds * 1000000000LL / elapsed : 0);
+  return 0;
+}
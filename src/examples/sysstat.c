@@ -0,0 +1,118 @@
+/* pintos -v -k --fs-disk=2 --qemu -p ../examples/sysstat -a sysstat -p ../examples/file_syscall_tests -a file_syscall_tests -- -f -q run 'sysstat file_syscall_tests'
+
+   Shows how often each system call was made, how often it failed
+   and how long it took, in time stamp counter cycles.
+
+   With a command line, runs it, waits for it and shows only the
+   system calls made meanwhile.  Without, shows the totals since
+   boot.  The percentiles are upper bounds, from a histogram with
+   a bucket per power of two.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+#define CALLS   64    /* max no of system calls to show */
+#define CMDSIZE 128   /* exec cmd line buffer */
+
+/* statistics before and after the command (static to keep them
+   off the one page user stack) */
+static struct sysstat before[CALLS];
+static struct sysstat after[CALLS];
+
+/* returns an upper bound for the cycles taken by the fastest pct
+   percent of the calls counted in s */
+static long long percentile(const struct sysstat* s, int pct)
+{
+  long long total = 0, seen = 0;
+  int i;
+
+  for (i = 0; i < SYSSTAT_BUCKETS; ++i)
+    total += s->hist[i];
+
+  for (i = 0; i < SYSSTAT_BUCKETS; ++i)
+  {
+    seen += s->hist[i];
+    if (seen * 100 >= total * pct)
+      break;
+  }
+  return 1LL << (i + 1);
+}
+
+static void print_stats(int before_cnt, int after_cnt)
+{
+  int i, j, k;
+
+  printf("%-15s %8s %8s %12s %12s %12s\n",
+         "syscall", "calls", "errors", "avg cycles", "p50 <", "p99 <");
+  for (i = 0; i < after_cnt; ++i)
+  {
+    struct sysstat delta = after[i];
+    long long returned = 0;
+
+    for (j = 0; j < before_cnt; ++j)
+      if (strcmp(before[j].name, after[i].name) == 0)
+      {
+        delta.call_cnt -= before[j].call_cnt;
+        delta.error_cnt -= before[j].error_cnt;
+        delta.cycles -= before[j].cycles;
+        for (k = 0; k < SYSSTAT_BUCKETS; ++k)
+          delta.hist[k] -= before[j].hist[k];
+        break;
+      }
+
+    if (delta.call_cnt == 0)
+      continue;
+
+    // exit never returns, so it has no times
+    for (k = 0; k < SYSSTAT_BUCKETS; ++k)
+      returned += delta.hist[k];
+    if (returned == 0)
+    {
+      printf("%-15s %8lld %8lld %12s %12s %12s\n",
+             delta.name, delta.call_cnt, delta.error_cnt, "-", "-", "-");
+      continue;
+    }
+
+    printf("%-15s %8lld %8lld %12lld %12lld %12lld\n",
+           delta.name, delta.call_cnt, delta.error_cnt,
+           delta.cycles / returned,
+           percentile(&delta, 50), percentile(&delta, 99));
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  char cmd[CMDSIZE] = "";
+  int before_cnt = 0;
+  int i;
+
+  if (argc == 1)
+  {
+    print_stats(0, sysstat(after, CALLS));
+    return 0;
+  }
+
+  for (i = 1; i < argc; ++i)
+  {
+    if (i > 1)
+      strlcat(cmd, " ", CMDSIZE);
+    strlcat(cmd, argv[i], CMDSIZE);
+  }
+
+  before_cnt = sysstat(before, CALLS);
+
+  int pid = exec(cmd);
+  if (pid == -1)
+  {
+    printf("ERROR: could not start '%s'\n", cmd);
+    return -1;
+  }
+  int status = wait(pid);
+
+  // The exec and wait above are counted too
+  print_stats(before_cnt, sysstat(after, CALLS));
+  printf("'%s' exited with %d\n", cmd, status);
+  return 0;
+}
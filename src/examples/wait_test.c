@@ -39,6 +39,14 @@ int main(void)
 
   // Don't sleep here, we want to call wait before the child is done.
 
+  // The child sleeps for a second, so a short timed wait gives up.
+  result = wait_timeout(pid, 10);
+  if (result != WAIT_TIMEOUT)
+  {
+    printf("ERROR: Expected wait_timeout to time out, but got: %d\n", result);
+    return -1;
+  }
+
   result = wait(pid);
   if (result != 20)
   {
@@ -8,6 +8,7 @@
 #include "filesys/directory.h"
 #include "devices/disk.h"
 #include "threads/synch.h"
+#include "threads/workqueue.h"
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
@@ -37,6 +38,9 @@ filesys_init (bool format)
 void
 filesys_done (void)
 {
+  /* Let queued zero-fills reach the disk before the free map is
+     written out and the file system goes away. */
+  flush_work (&system_wq);
   free_map_close ();
 }
 
@@ -7,6 +7,7 @@
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/workqueue.h"
 
 
 /* Identifies an inode. */
@@ -38,10 +39,7 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     struct inode_disk data;             /* Inode content. */
-    struct lock write_lock;             /* Lock for writing to inode */
-    struct condition write_cond;        /* Condition variable for writing */
-    bool writing;                       /* True if writing to inode */
-    int readers;                        /* Number of readers */
+    struct rwlock rwlock;               /* Readers-writer lock for data. */
   };
 
 
@@ -64,12 +62,38 @@ byte_to_sector (const struct inode *inode, off_t pos)
 static struct list open_inodes;
 struct lock open_inodes_lock;            /* Lock for inode list */
 
+/* Data sectors of a new inode that are being zero-filled on
+   system_wq.  An inode whose data overlaps one of these may not
+   be opened until the zero-fill is done. */
+struct zero_fill
+  {
+    struct list_elem elem;              /* Element in pending_fills. */
+    disk_sector_t start;                /* First sector to clear. */
+    size_t sectors;                     /* Number of sectors. */
+    struct list waiters;                /* List of struct fill_waiter. */
+  };
+
+/* A thread in wait_for_zero_fill(), waiting for one zero-fill. */
+struct fill_waiter
+  {
+    struct list_elem elem;              /* Element in zero_fill's `waiters'. */
+    struct semaphore done;              /* Upped when the fill is done. */
+  };
+static struct list pending_fills;
+static struct lock pending_fills_lock;
+
+static void write_zeros (disk_sector_t start, size_t sectors);
+static work_func zero_fill;
+static void wait_for_zero_fill (const struct inode_disk *);
+
 /* Initializes the inode module. */
 void
 inode_init (void)
 {
   list_init (&open_inodes);
-  lock_init (&open_inodes_lock);
+  lock_init_named (&open_inodes_lock, "open_inodes");
+  list_init (&pending_fills);
+  lock_init (&pending_fills_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -100,11 +124,19 @@ inode_create (disk_sector_t sector, off_t length)
           disk_write (filesys_disk, sector, disk_inode);
           if (sectors > 0)
             {
-              static char zeros[DISK_SECTOR_SIZE];
-              size_t i;
-
-              for (i = 0; i < sectors; i++)
-                disk_write (filesys_disk, disk_inode->start + i, zeros);
+              struct zero_fill *zf = malloc (sizeof *zf);
+              if (zf != NULL)
+                {
+                  zf->start = disk_inode->start;
+                  zf->sectors = sectors;
+                  list_init (&zf->waiters);
+                  lock_acquire (&pending_fills_lock);
+                  list_push_back (&pending_fills, &zf->elem);
+                  lock_release (&pending_fills_lock);
+                  queue_work (&system_wq, zero_fill, zf);
+                }
+              else
+                write_zeros (disk_inode->start, sectors);
             }
           success = true;
         }
@@ -133,6 +165,7 @@ inode_open (disk_sector_t sector)
         {
           inode_reopen (inode);
           lock_release(&open_inodes_lock);
+          wait_for_zero_fill (&inode->data);
           return inode;
         }
     }
@@ -151,17 +184,87 @@ inode_open (disk_sector_t sector)
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->removed = false;
-  inode->readers = 0;
-  lock_init(&inode->write_lock);
-  cond_init(&inode->write_cond);
-  inode->writing = false;
+  rwlock_init (&inode->rwlock, RWLOCK_PHASE_FAIR);
 
   disk_read (filesys_disk, inode->sector, &inode->data);
-
   lock_release(&open_inodes_lock);
+
+  /* Not under open_inodes_lock, so that only openers of this
+     inode wait for its fill. */
+  wait_for_zero_fill (&inode->data);
   return inode;
 }
 
+/* Writes zeros to the SECTORS disk sectors starting at START. */
+static void
+write_zeros (disk_sector_t start, size_t sectors)
+{
+  static char zeros[DISK_SECTOR_SIZE];
+  size_t i;
+
+  for (i = 0; i < sectors; i++)
+    disk_write (filesys_disk, start + i, zeros);
+}
+
+/* Work function that zero-fills the sectors described by ZF_, a
+   struct zero_fill on pending_fills, and then takes it off the
+   list, wakes up its waiters and frees it. */
+static void
+zero_fill (void *zf_)
+{
+  struct zero_fill *zf = zf_;
+
+  write_zeros (zf->start, zf->sectors);
+
+  lock_acquire (&pending_fills_lock);
+  list_remove (&zf->elem);
+  while (!list_empty (&zf->waiters))
+    {
+      struct fill_waiter *w = list_entry (list_pop_front (&zf->waiters),
+                                          struct fill_waiter, elem);
+      sema_up (&w->done);
+    }
+  lock_release (&pending_fills_lock);
+  free (zf);
+}
+
+/* Waits until no zero-fill is pending for the data sectors of
+   the inode whose on-disk content is DATA. */
+static void
+wait_for_zero_fill (const struct inode_disk *data)
+{
+  disk_sector_t end = data->start + bytes_to_sectors (data->length);
+  bool pending;
+
+  /* Sectors freed by removed files may be covered by several
+     fills, so look again after each one. */
+  do
+    {
+      struct fill_waiter w;
+      struct list_elem *e;
+
+      pending = false;
+      lock_acquire (&pending_fills_lock);
+      for (e = list_begin (&pending_fills); e != list_end (&pending_fills);
+           e = list_next (e))
+        {
+          struct zero_fill *zf = list_entry (e, struct zero_fill, elem);
+          if (zf->start < end && data->start < zf->start + zf->sectors)
+            {
+              sema_init (&w.done, 0);
+              list_push_back (&zf->waiters, &w.elem);
+              pending = true;
+              break;
+            }
+        }
+      lock_release (&pending_fills_lock);
+
+      if (pending)
+        sema_down (&w.done);
+    }
+  while (pending);
+}
+
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode)
@@ -230,14 +333,8 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
-  
-  lock_acquire(&inode->write_lock);
-  // Wait for writing to finish
-  while (inode->writing) {
-    cond_wait(&inode->write_cond, &inode->write_lock);
-    }
-  ++inode->readers;
-  lock_release(&inode->write_lock);
+
+  rwlock_acquire_read (&inode->rwlock);
 
   while (size > 0)
     {
@@ -280,12 +377,8 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       bytes_read += chunk_size;
     }
   free (bounce);
-    
-  lock_acquire(&inode->write_lock);
-  --inode->readers;
-  // Signal writing to continue
-  if (inode->readers == 0) cond_broadcast(&inode->write_cond, &inode->write_lock);
-  lock_release(&inode->write_lock);
+
+  rwlock_release_read (&inode->rwlock);
   return bytes_read;
 }
 
@@ -302,13 +395,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
 
-  lock_acquire(&inode->write_lock);
-  // Wait for writing to finish
-  while (inode->writing || inode->readers) {
-    cond_wait(&inode->write_cond, &inode->write_lock);
-    }
-  inode->writing = true;
-  lock_release(&inode->write_lock);
+  rwlock_acquire_write (&inode->rwlock);
 
   while (size > 0)
     {
@@ -359,12 +446,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
     }
   free (bounce);
 
-  lock_acquire(&inode->write_lock);
-  inode->writing = false;
-  // Signal reading to continue
-  cond_broadcast(&inode->write_cond, &inode->write_lock);
-  lock_release(&inode->write_lock);
-
+  rwlock_release_write (&inode->rwlock);
   return bytes_written;
 }
 
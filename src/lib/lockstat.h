@@ -0,0 +1,16 @@
+#ifndef __LIB_LOCKSTAT_H
+#define __LIB_LOCKSTAT_H
+
+/* Contention statistics for one named kernel lock, as returned by
+   the lockstat system call.  Times are in timer ticks. */
+struct lockstat
+  {
+    char name[16];                  /* Lock name. */
+    long long acquire_cnt;          /* # of acquisitions. */
+    long long contended_cnt;        /* # of acquisitions that waited. */
+    long long wait_ticks;           /* Total ticks spent waiting. */
+    long long max_wait_ticks;       /* Longest single wait. */
+    long long hold_ticks;           /* Total ticks the lock was held. */
+  };
+
+#endif /* lib/lockstat.h */
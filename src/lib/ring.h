@@ -0,0 +1,44 @@
+#ifndef __LIB_RING_H
+#define __LIB_RING_H
+
+#include <stdint.h>
+
+/* Number of entries in each ring.  A power of two. */
+#define RING_ENTRIES 32
+
+/* An operation on the submission ring: system call NR with
+   arguments ARGS, exactly as it would be made directly.  Only
+   file system calls can be queued: create, remove, open,
+   filesize, read, write, seek, tell and close.  Others complete
+   with result -1. */
+struct ring_sqe
+  {
+    int nr;                     /* System call number, SYS_*. */
+    int32_t args[3];            /* Its arguments. */
+    uint32_t user_data;         /* Passed on to the completion. */
+  };
+
+/* A finished operation on the completion ring. */
+struct ring_cqe
+  {
+    int32_t result;             /* What the system call returned. */
+    uint32_t user_data;         /* From the submission. */
+  };
+
+/* Submission and completion rings, in user memory that the
+   kernel reads and writes directly, as registered with the
+   ring_setup system call.
+
+   The counters run freely; entry I is at index I % RING_ENTRIES.
+   The user program queues operations by filling sq[] and
+   advancing SQ_TAIL, and consumes results by advancing CQ_HEAD.
+   The kernel advances SQ_HEAD and CQ_TAIL. */
+struct ring
+  {
+    uint32_t sq_head, sq_tail;  /* Submission ring counters. */
+    uint32_t cq_head, cq_tail;  /* Completion ring counters. */
+    struct ring_sqe sq[RING_ENTRIES];
+    struct ring_cqe cq[RING_ENTRIES];
+  };
+
+#endif /* lib/ring.h */
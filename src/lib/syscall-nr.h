@@ -22,6 +22,18 @@ enum
     /* Added system calls */
     SYS_SLEEP,
     SYS_PLIST,
+    SYS_LOCKSTAT,               /* Read kernel lock contention profile. */
+    SYS_WAIT_TIMEOUT,           /* Wait for a child, with a time limit. */
+    SYS_CLOCK_GETTIME,          /* Read a high-resolution clock. */
+    SYS_FUTEX_WAIT,             /* Sleep if a word holds a value. */
+    SYS_FUTEX_WAKE,             /* Wake threads sleeping on a word. */
+    SYS_SYSSTAT,                /* Read system call statistics. */
+    SYS_RING_SETUP,             /* Register batched syscall rings. */
+    SYS_RING_ENTER,             /* Run queued system calls. */
+    SYS_PREAD,                  /* Read from a file at a position. */
+    SYS_PWRITE,                 /* Write to a file at a position. */
+    SYS_READV,                  /* Read into several buffers. */
+    SYS_WRITEV,                 /* Write from several buffers. */
 
     /* Memory mapping system calls. */
     SYS_MMAP,                   /* Map a file into memory. */
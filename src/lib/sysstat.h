@@ -0,0 +1,22 @@
+#ifndef __LIB_SYSSTAT_H
+#define __LIB_SYSSTAT_H
+
+/* Number of latency buckets in struct sysstat. */
+#define SYSSTAT_BUCKETS 32
+
+/* Statistics for one system call, as returned by the sysstat
+   system call.  Times are in time stamp counter cycles, from
+   entering the system call handler to leaving it, so they include
+   any time spent blocked. */
+struct sysstat
+  {
+    char name[16];                  /* System call name. */
+    long long call_cnt;             /* # of calls. */
+    long long error_cnt;            /* # of calls that returned < 0. */
+    long long cycles;               /* Total cycles of returned calls. */
+    long long hist[SYSSTAT_BUCKETS]; /* hist[i]: # of calls that took
+                                        2**i to 2**(i+1) - 1 cycles,
+                                        the last one also longer. */
+  };
+
+#endif /* lib/sysstat.h */
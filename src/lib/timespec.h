@@ -0,0 +1,15 @@
+#ifndef __LIB_TIMESPEC_H
+#define __LIB_TIMESPEC_H
+
+/* Clocks that clock_gettime() can read. */
+#define CLOCK_MONOTONIC 1       /* Time since the OS booted. */
+
+/* A point in time, as returned by the clock_gettime system
+   call. */
+struct timespec
+  {
+    long tv_sec;                /* Seconds. */
+    long tv_nsec;               /* Nanoseconds, 0...999,999,999. */
+  };
+
+#endif /* lib/timespec.h */
@@ -0,0 +1,97 @@
+#include <batch.h>
+#include <string.h>
+#include "../syscall-nr.h"
+
+static void prep (struct ring_sqe *, int nr, int32_t arg0, int32_t arg1,
+                  int32_t arg2, uint32_t user_data);
+
+/* Empties RING and registers it with the kernel.  Returns true
+   if successful, false if the process already has a ring. */
+bool
+ring_init (struct ring *ring)
+{
+  memset (ring, 0, sizeof *ring);
+  return ring_setup (ring) == 0;
+}
+
+/* Returns the next free entry on RING's submission ring, queued
+   for the next ring_submit(), or a null pointer if the ring is
+   full.  The caller must fill it in with a ring_prep_*()
+   function. */
+struct ring_sqe *
+ring_get_sqe (struct ring *ring)
+{
+  if (ring->sq_tail - ring->sq_head == RING_ENTRIES)
+    return NULL;
+  return &ring->sq[ring->sq_tail++ % RING_ENTRIES];
+}
+
+/* Runs every queued operation with one system call and returns
+   how many ran, or -1 on error.  Fewer run if the completion
+   ring fills up. */
+int
+ring_submit (struct ring *ring, unsigned min_complete)
+{
+  return ring_enter (ring->sq_tail - ring->sq_head, min_complete);
+}
+
+/* Removes the oldest completion from RING into *CQE.  Returns
+   false if there is none. */
+bool
+ring_get_cqe (struct ring *ring, struct ring_cqe *cqe)
+{
+  if (ring->cq_head == ring->cq_tail)
+    return false;
+  *cqe = ring->cq[ring->cq_head++ % RING_ENTRIES];
+  return true;
+}
+
+/* Queues open(FILE). */
+void
+ring_prep_open (struct ring_sqe *sqe, const char *file, uint32_t user_data)
+{
+  prep (sqe, SYS_OPEN, (int32_t) file, 0, 0, user_data);
+}
+
+/* Queues close(FD). */
+void
+ring_prep_close (struct ring_sqe *sqe, int fd, uint32_t user_data)
+{
+  prep (sqe, SYS_CLOSE, fd, 0, 0, user_data);
+}
+
+/* Queues read(FD, BUFFER, LENGTH). */
+void
+ring_prep_read (struct ring_sqe *sqe, int fd, void *buffer, unsigned length,
+                uint32_t user_data)
+{
+  prep (sqe, SYS_READ, fd, (int32_t) buffer, length, user_data);
+}
+
+/* Queues write(FD, BUFFER, LENGTH). */
+void
+ring_prep_write (struct ring_sqe *sqe, int fd, const void *buffer,
+                 unsigned length, uint32_t user_data)
+{
+  prep (sqe, SYS_WRITE, fd, (int32_t) buffer, length, user_data);
+}
+
+/* Queues seek(FD, POSITION). */
+void
+ring_prep_seek (struct ring_sqe *sqe, int fd, unsigned position,
+                uint32_t user_data)
+{
+  prep (sqe, SYS_SEEK, fd, position, 0, user_data);
+}
+
+/* Fills in SQE as system call NR with the given arguments. */
+static void
+prep (struct ring_sqe *sqe, int nr, int32_t arg0, int32_t arg1,
+      int32_t arg2, uint32_t user_data)
+{
+  sqe->nr = nr;
+  sqe->args[0] = arg0;
+  sqe->args[1] = arg1;
+  sqe->args[2] = arg2;
+  sqe->user_data = user_data;
+}
@@ -0,0 +1,30 @@
+#ifndef __LIB_USER_BATCH_H
+#define __LIB_USER_BATCH_H
+
+#include <stdbool.h>
+#include <syscall.h>
+
+/* Batched system calls on the rings of lib/ring.h.
+
+   Queue operations with ring_get_sqe() and one of the
+   ring_prep_*() functions, run them all with a single
+   ring_submit(), then collect the results with ring_get_cqe().
+   Operations run in the order they were queued, so a write may
+   use the buffer filled by a read queued before it. */
+
+bool ring_init (struct ring *);
+struct ring_sqe *ring_get_sqe (struct ring *);
+int ring_submit (struct ring *, unsigned min_complete);
+bool ring_get_cqe (struct ring *, struct ring_cqe *);
+
+void ring_prep_open (struct ring_sqe *, const char *file,
+                     uint32_t user_data);
+void ring_prep_close (struct ring_sqe *, int fd, uint32_t user_data);
+void ring_prep_read (struct ring_sqe *, int fd, void *buffer,
+                     unsigned length, uint32_t user_data);
+void ring_prep_write (struct ring_sqe *, int fd, const void *buffer,
+                      unsigned length, uint32_t user_data);
+void ring_prep_seek (struct ring_sqe *, int fd, unsigned position,
+                     uint32_t user_data);
+
+#endif /* lib/user/batch.h */
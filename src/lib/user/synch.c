@@ -0,0 +1,122 @@
+#include <synch.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* The mutex is the three-state futex mutex from Ulrich
+   Drepper's "Futexes Are Tricky".  STATE is 0 when the mutex is
+   free, 1 when it is locked and nobody waits, and 2 when it is
+   locked and someone may be waiting.  Only the slow paths, going
+   from 1 to 2 or unlocking in state 2, enter the kernel. */
+
+static void lock_contended (struct mutex *, int state);
+
+/* Initializes M as a free mutex. */
+void
+mutex_init (struct mutex *m)
+{
+  m->state = 0;
+}
+
+/* Locks M, sleeping until it is free if necessary. */
+void
+mutex_lock (struct mutex *m)
+{
+  int state = __sync_val_compare_and_swap (&m->state, 0, 1);
+
+  if (state != 0)
+    lock_contended (m, state);
+}
+
+/* Locks M if it is free.  Returns true if successful, false if M
+   is locked by someone else.  Never sleeps. */
+bool
+mutex_trylock (struct mutex *m)
+{
+  return __sync_bool_compare_and_swap (&m->state, 0, 1);
+}
+
+/* Unlocks M, which must be locked by the caller, and wakes up
+   one waiter if there may be any. */
+void
+mutex_unlock (struct mutex *m)
+{
+  if (__sync_fetch_and_sub (&m->state, 1) != 1)
+    {
+      m->state = 0;
+      futex_wake (&m->state, 1);
+    }
+}
+
+/* Locks M after finding it in STATE, which is not 0.  Marks M as
+   having waiters, then sleeps until it is free. */
+static void
+lock_contended (struct mutex *m, int state)
+{
+  if (state != 2)
+    state = __sync_lock_test_and_set (&m->state, 2);
+  while (state != 0)
+    {
+      futex_wait (&m->state, 2, -1);
+      state = __sync_lock_test_and_set (&m->state, 2);
+    }
+}
+
+/* Initializes CV as a condition variable nobody waits on. */
+void
+cond_init (struct condvar *cv)
+{
+  cv->seq = 0;
+  cv->waiters = 0;
+}
+
+/* Unlocks M, which must be locked by the caller, waits for CV to
+   be signaled and locks M again.  As with any condition variable,
+   the caller must check its condition again on return. */
+void
+cond_wait (struct condvar *cv, struct mutex *m)
+{
+  cond_wait_timeout (cv, m, -1);
+}
+
+/* Like cond_wait(), but gives up after TIMEOUT_MS milliseconds
+   if TIMEOUT_MS is not negative.  Returns false if it gave up,
+   true otherwise.  M is locked again either way. */
+bool
+cond_wait_timeout (struct condvar *cv, struct mutex *m, int timeout_ms)
+{
+  int seq;
+  int result;
+
+  __sync_fetch_and_add (&cv->waiters, 1);
+  seq = cv->seq;
+  mutex_unlock (m);
+
+  /* A signal between reading SEQ and sleeping changes SEQ, so
+     futex_wait() returns at once instead of missing it. */
+  result = futex_wait (&cv->seq, seq, timeout_ms);
+
+  __sync_fetch_and_sub (&cv->waiters, 1);
+
+  /* Others may have been woken with us by cond_broadcast(), so
+     relock as if contended, or their wakeups could be lost. */
+  lock_contended (m, 1);
+  return result != FUTEX_TIMEDOUT;
+}
+
+/* Wakes up one thread waiting on CV, if any. */
+void
+cond_signal (struct condvar *cv)
+{
+  __sync_fetch_and_add (&cv->seq, 1);
+  if (cv->waiters > 0)
+    futex_wake (&cv->seq, 1);
+}
+
+/* Wakes up every thread waiting on CV. */
+void
+cond_broadcast (struct condvar *cv)
+{
+  __sync_fetch_and_add (&cv->seq, 1);
+  if (cv->waiters > 0)
+    futex_wake (&cv->seq, INT_MAX);
+}
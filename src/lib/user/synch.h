@@ -0,0 +1,43 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* Mutexes and condition variables for user programs, built on
+   the futex_wait() and futex_wake() system calls.  Locking a
+   free mutex, unlocking a mutex nobody waits for and signaling a
+   condition nobody waits on are a few atomic instructions and no
+   system call.
+
+   The state lives entirely in the structure, so it works
+   between any threads that can see the same memory. */
+
+/* Mutex. */
+struct mutex
+  {
+    int state;                  /* 0: free, 1: locked, 2: locked, waiters. */
+  };
+
+#define MUTEX_INITIALIZER { 0 }
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* Condition variable. */
+struct condvar
+  {
+    int seq;                    /* Incremented by every signal. */
+    int waiters;                /* Number of threads in cond_wait(). */
+  };
+
+#define CONDVAR_INITIALIZER { 0, 0 }
+
+void cond_init (struct condvar *);
+void cond_wait (struct condvar *, struct mutex *);
+bool cond_wait_timeout (struct condvar *, struct mutex *, int timeout_ms);
+void cond_signal (struct condvar *);
+void cond_broadcast (struct condvar *);
+
+#endif /* lib/user/synch.h */
@@ -61,6 +61,25 @@
           retval;                                               \
         })
 
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "    \
+             "pushl %[arg0]; "                                  \
+             "pushl %[number]; int $0x30; addl $20, %%esp"      \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "g" (ARG0),                             \
+                 [arg1] "g" (ARG1),                             \
+                 [arg2] "g" (ARG2),                             \
+                 [arg3] "g" (ARG3)                              \
+               : "memory");                                     \
+          retval;                                               \
+        })
+
 void
 halt (void)
 {
@@ -191,4 +210,64 @@ sleep (int ms) {
 void
 plist (void) {
   return syscall0(SYS_PLIST);
-}
\ No newline at end of file
+}
+
+int
+lockstat (struct lockstat *stats, int max) {
+  return syscall2(SYS_LOCKSTAT, stats, max);
+}
+
+int
+wait_timeout (pid_t pid, int ms) {
+  return syscall2(SYS_WAIT_TIMEOUT, pid, ms);
+}
+
+int
+clock_gettime (int clock_id, struct timespec *ts) {
+  return syscall2(SYS_CLOCK_GETTIME, clock_id, ts);
+}
+
+int
+futex_wait (int *addr, int expected, int timeout_ms) {
+  return syscall3(SYS_FUTEX_WAIT, addr, expected, timeout_ms);
+}
+
+int
+futex_wake (int *addr, int cnt) {
+  return syscall2(SYS_FUTEX_WAKE, addr, cnt);
+}
+
+int
+sysstat (struct sysstat *stats, int max) {
+  return syscall2(SYS_SYSSTAT, stats, max);
+}
+
+int
+ring_setup (struct ring *ring) {
+  return syscall1(SYS_RING_SETUP, ring);
+}
+
+int
+ring_enter (unsigned n_submit, unsigned min_complete) {
+  return syscall2(SYS_RING_ENTER, n_submit, min_complete);
+}
+
+int
+pread (int fd, void *buffer, unsigned length, unsigned offset) {
+  return syscall4(SYS_PREAD, fd, buffer, length, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned length, unsigned offset) {
+  return syscall4(SYS_PWRITE, fd, buffer, length, offset);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt) {
+  return syscall3(SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt) {
+  return syscall3(SYS_WRITEV, fd, iov, iovcnt);
+}
@@ -3,6 +3,11 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <lockstat.h>
+#include <sysstat.h>
+#include <ring.h>
+#include <iovec.h>
+#include <timespec.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -48,5 +53,25 @@ int inumber (int fd);
 /* Added system calls */
 void sleep (int ms);
 void plist (void);
+int lockstat (struct lockstat *stats, int max);
+int wait_timeout (pid_t, int ms);
+int clock_gettime (int clock_id, struct timespec *);
+int futex_wait (int *addr, int expected, int timeout_ms);
+int futex_wake (int *addr, int cnt);
+int sysstat (struct sysstat *stats, int max);
+int ring_setup (struct ring *);
+int ring_enter (unsigned n_submit, unsigned min_complete);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+
+/* Returned by wait_timeout() when the child is still running. */
+#define WAIT_TIMEOUT -2
+
+/* Returned by futex_wait(). */
+#define FUTEX_WOKEN 0           /* Woken by futex_wake(). */
+#define FUTEX_MISMATCH -1       /* *ADDR did not hold EXPECTED. */
+#define FUTEX_TIMEDOUT -2       /* TIMEOUT_MS passed first. */
 
 #endif /* lib/user/syscall.h */
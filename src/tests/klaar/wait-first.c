@@ -0,0 +1,18 @@
+/* The first process has no parent process, but main() still waits
+   for it.  Sleeps long enough that main() is surely blocked in
+   process_wait() by the time it exits, so the kernel must wake it
+   up for the run to finish.
+   (spawn_bench only waits on children of user processes.)
+*/
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  msg ("sleep");
+  sleep (1000);
+  msg ("wake up");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(wait-first) begin
+(wait-first) sleep
+(wait-first) wake up
+(wait-first) end
+wait-first: exit(0)
+EOF
+pass;
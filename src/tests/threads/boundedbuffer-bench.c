@@ -0,0 +1,162 @@
+/* Measures bounded_buffer throughput for one producer and one
+   consumer, several producers and one consumer, and several
+   producers and consumers, passing one value per call.  The
+   one-to-one case is also measured with bb_write_n()/bb_read_n()
+   and with the lock-free single-producer/single-consumer path.
+
+   Checks that every value written is read exactly once and prints
+   the number of values per second for each case. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/boundedbuffer.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITEM_CNT 24000          /* Values passed per measurement. */
+#define BUF_SIZE 64             /* Buffer capacity. */
+#define BATCH_SIZE 16           /* Values per batch operation. */
+
+enum bench_mode
+  {
+    BENCH_SINGLE,               /* bb_write()/bb_read(). */
+    BENCH_BATCH,                /* bb_write_n()/bb_read_n(). */
+    BENCH_SPSC                  /* bb_spsc_put()/bb_spsc_get(). */
+  };
+
+static struct bounded_buffer bb;
+static enum bench_mode mode;
+static int per_producer, per_consumer;
+static struct lock sum_lock;
+static long long consumed_sum;
+static struct semaphore done;
+
+static thread_func producer, consumer;
+static void run_bench (const char *name, enum bench_mode,
+                       int producer_cnt, int consumer_cnt);
+
+void
+test_boundedbuffer_bench (void)
+{
+  lock_init (&sum_lock);
+  sema_init (&done, 0);
+  run_bench ("1:1", BENCH_SINGLE, 1, 1);
+  run_bench ("4:1", BENCH_SINGLE, 4, 1);
+  run_bench ("4:4", BENCH_SINGLE, 4, 4);
+  run_bench ("1:1 batch", BENCH_BATCH, 1, 1);
+  run_bench ("1:1 spsc", BENCH_SPSC, 1, 1);
+  pass ();
+}
+
+/* Passes ITEM_CNT values from PRODUCER_CNT producer threads to
+   CONSUMER_CNT consumer threads using MODE and prints the
+   throughput under NAME. */
+static void
+run_bench (const char *name, enum bench_mode mode_,
+           int producer_cnt, int consumer_cnt)
+{
+  long long expected;
+  int64_t start, elapsed;
+  int i;
+
+  mode = mode_;
+  per_producer = ITEM_CNT / producer_cnt;
+  per_consumer = ITEM_CNT / consumer_cnt;
+  expected = (long long) producer_cnt * per_producer * (per_producer - 1) / 2;
+  consumed_sum = 0;
+  bb_init (&bb, BUF_SIZE);
+
+  start = timer_ticks ();
+  for (i = 0; i < producer_cnt; i++)
+    thread_create ("producer", PRI_DEFAULT, producer, NULL);
+  for (i = 0; i < consumer_cnt; i++)
+    thread_create ("consumer", PRI_DEFAULT, consumer, NULL);
+  for (i = 0; i < producer_cnt + consumer_cnt; i++)
+    sema_down (&done);
+  elapsed = timer_elapsed (start);
+
+  if (consumed_sum != expected)
+    fail ("%s: consumers saw sum %lld, expected %lld",
+          name, consumed_sum, expected);
+  if (elapsed < 1)
+    elapsed = 1;
+  msg ("%s: %d values in %lld ticks, %lld values/s", name, ITEM_CNT,
+       (long long) elapsed, (long long) ITEM_CNT * TIMER_FREQ / elapsed);
+
+  bb_destroy (&bb);
+}
+
+/* Writes the values 0...per_producer-1 to the buffer. */
+static void
+producer (void *aux UNUSED)
+{
+  int values[BATCH_SIZE];
+  int i, j;
+
+  switch (mode)
+    {
+    case BENCH_SINGLE:
+      for (i = 0; i < per_producer; i++)
+        bb_write (&bb, i);
+      break;
+
+    case BENCH_BATCH:
+      for (i = 0; i < per_producer; i += BATCH_SIZE)
+        {
+          for (j = 0; j < BATCH_SIZE; j++)
+            values[j] = i + j;
+          bb_write_n (&bb, values, BATCH_SIZE);
+        }
+      break;
+
+    case BENCH_SPSC:
+      for (i = 0; i < per_producer; i++)
+        while (!bb_spsc_put (&bb, i))
+          thread_yield ();
+      break;
+    }
+  sema_up (&done);
+}
+
+/* Reads per_consumer values from the buffer and adds them to
+   consumed_sum. */
+static void
+consumer (void *aux UNUSED)
+{
+  long long sum = 0;
+  int values[BATCH_SIZE];
+  int value;
+  int i, j;
+
+  switch (mode)
+    {
+    case BENCH_SINGLE:
+      for (i = 0; i < per_consumer; i++)
+        sum += bb_read (&bb);
+      break;
+
+    case BENCH_BATCH:
+      for (i = 0; i < per_consumer; i += BATCH_SIZE)
+        {
+          bb_read_n (&bb, values, BATCH_SIZE);
+          for (j = 0; j < BATCH_SIZE; j++)
+            sum += values[j];
+        }
+      break;
+
+    case BENCH_SPSC:
+      for (i = 0; i < per_consumer; i++)
+        {
+          while (!bb_spsc_get (&bb, &value))
+            thread_yield ();
+          sum += value;
+        }
+      break;
+    }
+
+  lock_acquire (&sum_lock);
+  consumed_sum += sum;
+  lock_release (&sum_lock);
+  sema_up (&done);
+}
@@ -0,0 +1,180 @@
+/* Measures SynchList throughput.  A producer and a consumer
+   thread pass ITEM_CNT items back and forth through two
+   SynchLists, one carrying full items to the consumer and one
+   returning empty items to the producer, using:
+
+     - sl_append()/sl_remove(), which allocate a descriptor per
+       item;
+
+     - sl_append_elem()/sl_remove_elem(), which use the list_elem
+       embedded in each item;
+
+     - sl_append_batch()/sl_remove_up_to(), which move up to
+       BATCH_SIZE items per lock hold.
+
+   Prints the number of items per second for each. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/synchlist.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITEM_CNT 50000          /* Items passed per measurement. */
+#define POOL_SIZE 64            /* Items in circulation. */
+#define BATCH_SIZE 16           /* Items per batch operation. */
+
+enum bench_mode
+  {
+    BENCH_MALLOC,               /* sl_append()/sl_remove(). */
+    BENCH_INTRUSIVE,            /* sl_append_elem()/sl_remove_elem(). */
+    BENCH_BATCH                 /* sl_append_batch()/sl_remove_up_to(). */
+  };
+
+struct bench_item
+  {
+    struct list_elem elem;
+    int value;
+  };
+
+static struct bench_item pool[POOL_SIZE];
+static struct SynchList full, empty;
+static struct semaphore done;
+static long long consumed_sum;
+
+static struct bench_item *get_item (struct SynchList *, enum bench_mode);
+static void put_item (struct SynchList *, struct bench_item *,
+                      enum bench_mode);
+static thread_func consumer;
+static void run_bench (const char *name, enum bench_mode);
+
+void
+test_synchlist_bench (void)
+{
+  sema_init (&done, 0);
+  run_bench ("malloc", BENCH_MALLOC);
+  run_bench ("intrusive", BENCH_INTRUSIVE);
+  run_bench ("batch", BENCH_BATCH);
+  pass ();
+}
+
+/* Passes ITEM_CNT items to a consumer thread using MODE and
+   prints the throughput under NAME. */
+static void
+run_bench (const char *name, enum bench_mode mode)
+{
+  long long expected = (long long) ITEM_CNT * (ITEM_CNT - 1) / 2;
+  int64_t start, elapsed;
+  int i;
+
+  sl_init (&full);
+  sl_init (&empty);
+  for (i = 0; i < POOL_SIZE; i++)
+    put_item (&empty, &pool[i], mode);
+  consumed_sum = 0;
+
+  start = timer_ticks ();
+  thread_create ("consumer", PRI_DEFAULT, consumer, (void *) mode);
+  if (mode == BENCH_BATCH)
+    {
+      int sent = 0;
+
+      while (sent < ITEM_CNT)
+        {
+          int want = ITEM_CNT - sent < BATCH_SIZE ? ITEM_CNT - sent
+                                                  : BATCH_SIZE;
+          struct list batch;
+          struct list_elem *e;
+
+          list_init (&batch);
+          sl_remove_up_to (&empty, &batch, want);
+          for (e = list_begin (&batch); e != list_end (&batch);
+               e = list_next (e))
+            list_entry (e, struct bench_item, elem)->value = sent++;
+          sl_append_batch (&full, &batch);
+        }
+    }
+  else
+    for (i = 0; i < ITEM_CNT; i++)
+      {
+        struct bench_item *item = get_item (&empty, mode);
+        item->value = i;
+        put_item (&full, item, mode);
+      }
+  sema_down (&done);
+  elapsed = timer_elapsed (start);
+
+  if (consumed_sum != expected)
+    fail ("%s: consumer saw sum %lld, expected %lld",
+          name, consumed_sum, expected);
+  if (elapsed < 1)
+    elapsed = 1;
+  msg ("%s: %d items in %lld ticks, %lld items/s", name, ITEM_CNT,
+       (long long) elapsed, (long long) ITEM_CNT * TIMER_FREQ / elapsed);
+
+  /* Only BENCH_MALLOC's elements were allocated by the list. */
+  if (mode == BENCH_MALLOC)
+    {
+      sl_destroy (&full);
+      sl_destroy (&empty);
+    }
+  else
+    {
+      sl_clear (&full);
+      sl_clear (&empty);
+    }
+}
+
+/* Consumer thread: takes ITEM_CNT items from `full', adds up
+   their values and returns them to `empty'. */
+static void
+consumer (void *mode_)
+{
+  enum bench_mode mode = (enum bench_mode) mode_;
+  int received = 0;
+
+  while (received < ITEM_CNT)
+    if (mode == BENCH_BATCH)
+      {
+        struct list batch;
+        struct list_elem *e;
+
+        list_init (&batch);
+        received += sl_remove_up_to (&full, &batch, BATCH_SIZE);
+        for (e = list_begin (&batch); e != list_end (&batch);
+             e = list_next (e))
+          consumed_sum += list_entry (e, struct bench_item, elem)->value;
+        sl_append_batch (&empty, &batch);
+      }
+    else
+      {
+        struct bench_item *item = get_item (&full, mode);
+        consumed_sum += item->value;
+        received++;
+        put_item (&empty, item, mode);
+      }
+  sema_up (&done);
+}
+
+/* Removes an item from SL, which is used according to MODE. */
+static struct bench_item *
+get_item (struct SynchList *sl, enum bench_mode mode)
+{
+  if (mode == BENCH_MALLOC)
+    return sl_remove (sl);
+  else
+    return list_entry (sl_remove_elem (sl), struct bench_item, elem);
+}
+
+/* Appends ITEM to SL, which is used according to MODE. */
+static void
+put_item (struct SynchList *sl, struct bench_item *item,
+          enum bench_mode mode)
+{
+  if (mode == BENCH_MALLOC)
+    sl_append (sl, item);
+  else
+    sl_append_elem (sl, &item->elem);
+}
@@ -39,7 +39,10 @@ static const struct test tests[] =
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
     {"threadtest", ThreadTest},
-    {"simplethreadtest", SimpleThreadTest}
+    {"simplethreadtest", SimpleThreadTest},
+    {"synchlist-bench", test_synchlist_bench},
+    {"boundedbuffer-bench", test_boundedbuffer_bench},
+    {"timeout-wheel", test_timeout_wheel}
   };
 
 static const char *test_name;
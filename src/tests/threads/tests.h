@@ -34,6 +34,9 @@ extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
 extern test_func ThreadTest;
 extern test_func SimpleThreadTest;
+extern test_func test_synchlist_bench;
+extern test_func test_boundedbuffer_bench;
+extern test_func test_timeout_wheel;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,125 @@
+/* Adds TIMEOUT_CNT timeouts with random delays, enough to need
+   cascading between the levels of the timing wheel, cancels
+   every third one and checks that each of the others fires
+   exactly once and never early.  Then checks that a timeout
+   function can add its own timeout again, as a periodic timer
+   would. */
+
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timeout.h"
+#include "devices/timer.h"
+
+#define TIMEOUT_CNT 2000        /* Number of timeouts. */
+#define MAX_DELAY 300           /* Longest delay, in ticks. */
+#define PERIOD_CNT 10           /* Times the periodic timeout runs. */
+
+struct test_timeout
+  {
+    struct timeout timeout;
+    int64_t due;                /* Earliest tick it may fire. */
+    int64_t fired;              /* Tick it fired, or 0. */
+    int fire_cnt;               /* Number of times it fired. */
+  };
+
+static struct test_timeout timeouts[TIMEOUT_CNT];
+static struct semaphore done;
+static int remaining;
+
+static timeout_func record, periodic;
+static void count_down (void);
+
+void
+test_timeout_wheel (void)
+{
+  static struct test_timeout tick;
+  int cancelled = 0;
+  int i;
+
+  sema_init (&done, 0);
+  random_init (0);
+
+  remaining = TIMEOUT_CNT;
+  for (i = 0; i < TIMEOUT_CNT; i++)
+    {
+      struct test_timeout *t = &timeouts[i];
+      int delay = random_ulong () % MAX_DELAY + 1;
+
+      t->due = timer_ticks () + delay;
+      timeout_add (&t->timeout, record, t, delay);
+    }
+  for (i = 0; i < TIMEOUT_CNT; i += 3)
+    if (timeout_cancel (&timeouts[i].timeout))
+      {
+        cancelled++;
+        count_down ();
+      }
+  sema_down (&done);
+  timer_sleep (2);
+
+  for (i = 0; i < TIMEOUT_CNT; i++)
+    {
+      struct test_timeout *t = &timeouts[i];
+
+      if (i % 3 == 0 && t->fire_cnt == 0)
+        continue;
+      if (t->fire_cnt != 1)
+        fail ("timeout %d fired %d times", i, t->fire_cnt);
+      if (t->fired < t->due)
+        fail ("timeout %d fired at tick %lld, before %lld",
+              i, t->fired, t->due);
+      if (t->fired > t->due + 1)
+        fail ("timeout %d fired at tick %lld, long after %lld",
+              i, t->fired, t->due);
+    }
+  msg ("%d timeouts fired on time, %d cancelled",
+       TIMEOUT_CNT - cancelled, cancelled);
+
+  timeout_add (&tick.timeout, periodic, &tick, 1);
+  sema_down (&done);
+  if (tick.fire_cnt != PERIOD_CNT || timeout_pending (&tick.timeout))
+    fail ("periodic timeout fired %d times", tick.fire_cnt);
+  msg ("periodic timeout fired %d times", tick.fire_cnt);
+
+  pass ();
+}
+
+/* Records when test_timeout T_ fired. */
+static void
+record (void *t_)
+{
+  struct test_timeout *t = t_;
+
+  t->fired = timer_ticks ();
+  t->fire_cnt++;
+  count_down ();
+}
+
+/* Counts one timeout as done, and wakes up the main thread when
+   all of them are. */
+static void
+count_down (void)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (--remaining == 0)
+    sema_up (&done);
+  intr_set_level (old_level);
+}
+
+/* Re-adds itself every tick until it has run PERIOD_CNT
+   times. */
+static void
+periodic (void *t_)
+{
+  struct test_timeout *t = t_;
+
+  if (++t->fire_cnt < PERIOD_CNT)
+    timeout_add (&t->timeout, periodic, t, 1);
+  else
+    sema_up (&done);
+}
@@ -10,27 +10,119 @@
 // Modified by Vlad Jahundovics (translation from C++ to C)
 
 #include "threads/boundedbuffer.h"
+#include <debug.h>
 #include "threads/malloc.h"
 
+// Number of values in the buffer
+static inline unsigned bb_count(const struct bounded_buffer *bb)
+{
+  return bb->tail - bb->head;
+}
+
 void bb_init(struct bounded_buffer *bb, int _size)
 {
+  unsigned slots = 1;
+
+  ASSERT(_size > 0);
+  while (slots < (unsigned) _size)
+    slots <<= 1;
+
   bb->size = _size;
-  // write your code here
+  bb->data = malloc(slots * sizeof *bb->data);
+  if (bb->data == NULL)
+    PANIC("bb_init: out of memory");
+  bb->mask = slots - 1;
+  bb->head = bb->tail = 0;
+  lock_init(&bb->lock);
+  cond_init(&bb->not_full);
+  cond_init(&bb->not_empty);
+}
+
+void bb_destroy(struct bounded_buffer *bb)
+{
+  free(bb->data);
+  bb->data = NULL;
+}
+
+int bb_read(struct bounded_buffer *bb)
+{
+  int value;
+  bb_read_n(bb, &value, 1);
+  return value;
 }
 
-void bb_destroy(struct bounded_buffer *bb UNUSED)
+void bb_write(struct bounded_buffer *bb, int value)
 {
-  // write your code here
+  bb_write_n(bb, &value, 1);
+}
+
+// Reads n values into "values", waiting for more whenever the buffer
+// runs empty.  Takes everything available per lock hold, so a reader
+// that is behind catches up in a few steps.
+void bb_read_n(struct bounded_buffer *bb, int *values, int n)
+{
+  lock_acquire(&bb->lock);
+  while (n > 0) {
+    while (bb_count(bb) == 0)
+      cond_wait(&bb->not_empty, &bb->lock);
+
+    int moved = 0;
+    while (moved < n && bb_count(bb) > 0)
+      values[moved++] = bb->data[bb->head++ & bb->mask];
+    values += moved;
+    n -= moved;
+
+    // One waiting writer per freed slot, not everybody
+    while (moved-- > 0)
+      cond_signal(&bb->not_full, &bb->lock);
+  }
+  lock_release(&bb->lock);
 }
 
-int bb_read(struct bounded_buffer *bb UNUSED)
+// Writes n values from "values", waiting for space whenever the
+// buffer is full.  Fills all free slots per lock hold.
+void bb_write_n(struct bounded_buffer *bb, const int *values, int n)
 {
-  // write your code here
-  return 0;
+  lock_acquire(&bb->lock);
+  while (n > 0) {
+    while (bb_count(bb) == (unsigned) bb->size)
+      cond_wait(&bb->not_full, &bb->lock);
+
+    int moved = 0;
+    while (moved < n && bb_count(bb) < (unsigned) bb->size)
+      bb->data[bb->tail++ & bb->mask] = values[moved++];
+    values += moved;
+    n -= moved;
+
+    // One waiting reader per new value, not everybody
+    while (moved-- > 0)
+      cond_signal(&bb->not_empty, &bb->lock);
+  }
+  lock_release(&bb->lock);
 }
 
-void bb_write(struct bounded_buffer *bb UNUSED, int value UNUSED)
+// Only the producer writes "tail" and only the consumer writes "head",
+// so each side just has to make its slot access visible before it
+// publishes the new counter.  Pintos runs on one CPU, so a compiler
+// barrier is enough.
+bool bb_spsc_put(struct bounded_buffer *bb, int value)
 {
-  // write your code here
+  unsigned tail = bb->tail;
+  if (tail - bb->head == (unsigned) bb->size)
+    return false;
+  bb->data[tail & bb->mask] = value;
+  barrier();
+  bb->tail = tail + 1;
+  return true;
 }
 
+bool bb_spsc_get(struct bounded_buffer *bb, int *value)
+{
+  unsigned head = bb->head;
+  if (bb->tail == head)
+    return false;
+  *value = bb->data[head & bb->mask];
+  barrier();
+  bb->head = head + 1;
+  return true;
+}
@@ -8,17 +8,35 @@
 #ifndef BOUNDEDBUFFER_H
 #define BOUNDEDBUFFER_H
 
+#include <stdbool.h>
 #include "threads/synch.h"
 
+// A ring of ints holding at most "size" values.  The ring itself is
+// rounded up to a power of two so that indexing is a mask, and
+// "head"/"tail" count reads and writes without ever wrapping back.
 struct bounded_buffer {
-  int size;
-  // You may add other data fields required for the bounded buffer
+  int size;                     // capacity, in values
+  int *data;                    // ring storage, mask + 1 slots
+  unsigned mask;
+  volatile unsigned head;       // total number of values read
+  volatile unsigned tail;       // total number of values written
 
+  struct lock lock;
+  struct condition not_full;    // writers waiting for space
+  struct condition not_empty;   // readers waiting for values
 };
 
 void bb_init(struct bounded_buffer *, int);
 int bb_read(struct bounded_buffer *);
 void bb_write(struct bounded_buffer *, int);
+void bb_read_n(struct bounded_buffer *, int *values, int n);
+void bb_write_n(struct bounded_buffer *, const int *values, int n);
 void bb_destroy(struct bounded_buffer *);
 
+// Lock-free single-producer/single-consumer path.  Never blocks, so it
+// may be used from interrupt context, but only if the buffer has
+// exactly one writer and one reader and both use these two functions.
+bool bb_spsc_put(struct bounded_buffer *, int value);
+bool bb_spsc_get(struct bounded_buffer *, int *value);
+
 #endif
@@ -0,0 +1,52 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/spinlock.h"
+#include "threads/thread.h"
+
+/* Most processors Pintos uses.  Any others stay halted. */
+#define CPU_MAX 8
+
+/* Threads waiting to run on one processor.  There is one FIFO
+   queue per priority level, and bit P of `mask' is set if and
+   only if queues[P] is non-empty, so the highest-priority ready
+   thread is found without scanning any list. */
+struct ready_queue
+  {
+    struct spinlock lock;       /* Protects the members below. */
+    struct list queues[PRI_MAX - PRI_MIN + 1];
+    uint64_t mask;              /* Non-empty queues. */
+    int cnt;                    /* # of threads in the queues. */
+  };
+
+/* Per-processor data.  cpus[0] is the bootstrap processor, the
+   one the BIOS started. */
+struct cpu
+  {
+    /* Owned by threads/mp.c. */
+    int id;                     /* Index in cpus[]. */
+    uint8_t lapic_id;           /* Local APIC ID. */
+    volatile bool started;      /* Set by the processor once it is up. */
+
+    /* Owned by threads/thread.c. */
+    struct thread *idle_thread; /* Runs when no other thread is ready. */
+    struct thread *running;     /* Thread running on this processor. */
+    struct ready_queue ready;   /* Threads waiting for this processor. */
+    unsigned thread_ticks;      /* # of timer ticks since last yield. */
+    long long idle_ticks;       /* # of timer ticks spent idle. */
+    long long busy_ticks;       /* # of timer ticks spent in threads. */
+    long long stolen_cnt;       /* # of threads taken from other CPUs. */
+    long long ipi_cnt;          /* # of reschedule IPIs received. */
+  };
+
+/* Processors, and how many of them run threads.  Only the first
+   cpu_cnt entries of cpus[] are in use. */
+extern struct cpu cpus[CPU_MAX];
+extern int cpu_cnt;
+
+struct cpu *cpu_current (void);
+
+#endif /* threads/cpu.h */
@@ -0,0 +1,90 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* Signed 17.14 fixed-point arithmetic, for the parts of the
+   scheduler that need fractions.  The kernel is compiled with
+   -msoft-float and must not touch the FPU, so real numbers are
+   represented as integers scaled by 2**14.
+
+   Functions taking two fixed_t arguments operate on two
+   fixed-point numbers; those whose second argument is an `int'
+   mix a fixed-point number with an integer. */
+typedef int32_t fixed_t;
+
+#define FIX_SHIFT 14                    /* Number of fraction bits. */
+#define FIX_ONE (1 << FIX_SHIFT)        /* 1.0 in fixed point. */
+
+/* Converts integer N to fixed point. */
+static inline fixed_t
+fix_int (int n)
+{
+  return n * FIX_ONE;
+}
+
+/* Converts fixed-point X to an integer, rounding toward zero. */
+static inline int
+fix_trunc (fixed_t x)
+{
+  return x / FIX_ONE;
+}
+
+/* Converts fixed-point X to an integer, rounding to nearest. */
+static inline int
+fix_round (fixed_t x)
+{
+  return x >= 0 ? (x + FIX_ONE / 2) / FIX_ONE : (x - FIX_ONE / 2) / FIX_ONE;
+}
+
+/* Returns X + Y. */
+static inline fixed_t
+fix_add (fixed_t x, fixed_t y)
+{
+  return x + y;
+}
+
+/* Returns X + N. */
+static inline fixed_t
+fix_add_int (fixed_t x, int n)
+{
+  return x + n * FIX_ONE;
+}
+
+/* Returns X - Y. */
+static inline fixed_t
+fix_sub (fixed_t x, fixed_t y)
+{
+  return x - y;
+}
+
+/* Returns X * Y.  The product is formed in 64 bits so that it
+   does not overflow before it is scaled back down. */
+static inline fixed_t
+fix_mul (fixed_t x, fixed_t y)
+{
+  return ((int64_t) x) * y / FIX_ONE;
+}
+
+/* Returns X * N. */
+static inline fixed_t
+fix_mul_int (fixed_t x, int n)
+{
+  return x * n;
+}
+
+/* Returns X / Y. */
+static inline fixed_t
+fix_div (fixed_t x, fixed_t y)
+{
+  return ((int64_t) x) * FIX_ONE / y;
+}
+
+/* Returns X / N. */
+static inline fixed_t
+fix_div_int (fixed_t x, int n)
+{
+  return x / n;
+}
+
+#endif /* threads/fixed-point.h */
@@ -12,18 +12,25 @@
 #include "devices/input.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "devices/timeout.h"
 #include "devices/vga.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
+#include "threads/mp.h"
 #include "threads/palloc.h"
+#include "threads/prof.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
+#include "userprog/pagedir.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "userprog/slowdown.h"
@@ -94,9 +101,6 @@ main (void)
   /* Initialize ourselves as a thread so we can use locks,
      then enable console locking. */
   thread_init ();
-#ifdef USERPROG
-  process_init ();
-#endif
   console_init ();
 
   /* Greet user. */
@@ -106,6 +110,9 @@ main (void)
   palloc_init ();
   malloc_init ();
   paging_init ();
+  trace_init ();
+  prof_init ();
+  mp_init ();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -119,6 +126,7 @@ main (void)
   kbd_init ();
   input_init ();
 #ifdef USERPROG
+  process_init ();
   exception_init ();
   syscall_init ();
   if (slow_kernel_threads) {
@@ -130,6 +138,8 @@ main (void)
   thread_start ();
   serial_init_queue ();
   timer_calibrate ();
+  mp_start ();
+  workqueue_init (&system_wq, "system_wq", 2);
 
 #ifdef FILESYS
   /* Initialize file system. */
@@ -273,6 +283,16 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-trace"))
+        trace_enabled = true;
+      else if (!strcmp (name, "-prof"))
+        prof_enabled = true;
+      else if (!strcmp (name, "-min-slice"))
+        thread_min_slice = atoi (value);
+      else if (!strcmp (name, "-max-slice"))
+        thread_max_slice = atoi (value);
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -285,6 +305,9 @@ parse_options (char **argv)
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
 
+  if (thread_min_slice < 1 || thread_max_slice < thread_min_slice)
+    PANIC ("time slice bounds must satisfy 1 <= -min-slice <= -max-slice");
+
   return argv;
 }
 
@@ -384,6 +407,11 @@ usage (void)
           "  -F=COUNT           Interrupts per second [20-60000].\n"
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -tickless          Stop the timer interrupt while idle.\n"
+          "  -trace             Record kernel events, dump them at power-off.\n"
+          "  -prof              Sample where time goes, dump it at power-off.\n"
+          "  -min-slice=TICKS   Shortest time slice, for interactive threads.\n"
+          "  -max-slice=TICKS   Longest time slice, for CPU-bound threads.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
           "  -fl=COUNT          Limit free memory to COUNT pages.\n"
@@ -410,6 +438,8 @@ hard_power_off (void)
 #endif
 
   print_stats ();
+  trace_dump ();
+  prof_dump ();
 
   printf ("Powering off...\n");
   serial_flush ();
@@ -457,7 +487,10 @@ static void
 print_stats (void)
 {
   timer_print_stats ();
+  timeout_print_stats ();
   thread_print_stats ();
+  lock_print_stats ();
+  workqueue_print_stats (&system_wq);
 #ifdef FILESYS
   disk_print_stats ();
 #endif
@@ -465,5 +498,6 @@ print_stats (void)
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
+  pagedir_print_stats ();
 #endif
 }
@@ -6,6 +6,8 @@
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/lapic.h"
+#include "threads/mp.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
@@ -26,7 +28,9 @@ static intr_handler_func *intr_handlers[INTR_CNT];
 static const char *intr_names[INTR_CNT];
 
 /* External interrupts are those generated by devices outside the
-   CPU, such as the timer.  External interrupts run with
+   CPU, such as the timer, and delivered by the PICs or by the
+   local APIC, which also delivers the interrupts that processors
+   send each other.  External interrupts run with
    interrupts turned off, so they never nest, nor are they ever
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
@@ -35,11 +39,26 @@ static const char *intr_names[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* Work that an external interrupt handler wants done outside of
+   the handler, with interrupts on, like a softirq.  It runs just
+   before the interrupt returns, on the interrupted thread's
+   stack, so it may be interrupted but must not sleep.  Work
+   raised while softirqs run is picked up by the same loop. */
+#define SOFTIRQ_CNT 8
+static intr_softirq_func *softirqs[SOFTIRQ_CNT];  /* Raised functions. */
+static int softirq_cnt;         /* Number of raised functions. */
+static bool in_softirq;         /* Are we running softirqs? */
+static bool yield_after_softirq; /* Should we yield once they are done? */
+
+static void run_softirqs (void);
+static bool is_external (uint8_t vec_no);
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
 
 /* Interrupt Descriptor Table helpers. */
+static void load_idt (void);
 static uint64_t make_intr_gate (void (*) (void), int dpl);
 static uint64_t make_trap_gate (void (*) (void), int dpl);
 static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
@@ -104,7 +123,6 @@ intr_disable (void)
 void
 intr_init (void)
 {
-  uint64_t idtr_operand;
   int i;
 
   /* Initialize interrupt controller. */
@@ -113,12 +131,7 @@ intr_init (void)
   /* Initialize IDT. */
   for (i = 0; i < INTR_CNT; i++)
     idt[i] = make_intr_gate (intr_stubs[i], 0);
-
-  /* Load IDT register.
-     See [IA32-v2a] "LIDT" and [IA32-v3a] 5.10 "Interrupt
-     Descriptor Table (IDT)". */
-  idtr_operand = make_idtr_operand (sizeof idt - 1, idt);
-  asm volatile ("lidt %0" : : "m" (idtr_operand));
+  load_idt ();
 
   /* Initialize intr_names. */
   for (i = 0; i < INTR_CNT; i++)
@@ -144,6 +157,24 @@ intr_init (void)
   intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Initializes the interrupt system of an application processor,
+   which shares the bootstrap processor's IDT. */
+void
+intr_init_ap (void)
+{
+  load_idt ();
+}
+
+/* Points the running processor's IDT register at the IDT.
+   See [IA32-v2a] "LIDT" and [IA32-v3a] 5.10 "Interrupt
+   Descriptor Table (IDT)". */
+static void
+load_idt (void)
+{
+  uint64_t idtr_operand = make_idtr_operand (sizeof idt - 1, idt);
+  asm volatile ("lidt %0" : : "m" (idtr_operand));
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -168,7 +199,7 @@ void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
                    const char *name)
 {
-  ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+  ASSERT (is_external (vec_no));
   register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -189,7 +220,7 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
                    intr_handler_func *handler, const char *name)
 {
-  ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+  ASSERT (!is_external (vec_no));
   register_handler (vec_no, dpl, level, handler, name);
 }
 
@@ -197,7 +228,7 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 void
 intr_clear_int (uint8_t vec_no)
 {
-  ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+  ASSERT (!is_external (vec_no));
   intr_handlers[vec_no] = NULL;
 }
 
@@ -205,13 +236,22 @@ intr_clear_int (uint8_t vec_no)
 intr_handler_func *
 intr_bypass_int (uint8_t vec_no, intr_handler_func *handler)
 {
-  ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+  ASSERT (!is_external (vec_no));
   ASSERT (intr_handlers[vec_no]);
   intr_handler_func *old = intr_handlers[vec_no];
   intr_handlers[vec_no] = handler;
   return old;
 }
 
+/* Returns true if VEC_NO is an external interrupt: 0x20...0x2f
+   from the PICs, or 0x40...0x4f from the local APIC. */
+static bool
+is_external (uint8_t vec_no)
+{
+  return ((vec_no >= 0x20 && vec_no < 0x30)
+          || (vec_no >= 0x40 && vec_no < 0x50));
+}
+
 /* Returns true during processing of an external interrupt
    and false at all other times. */
 bool
@@ -231,6 +271,19 @@ intr_yield_on_return (void)
   yield_on_return = true;
 }
 
+/* While softirqs are running, directs the external interrupt
+   handler that runs them to yield to a new process once they are
+   done, and returns true.  Returns false at any other time, when
+   the caller may yield itself. */
+bool
+intr_defer_yield (void)
+{
+  if (!in_softirq || in_external_intr)
+    return false;
+  yield_after_softirq = true;
+  return true;
+}
+
 /* 8259A Programmable Interrupt Controller. */
 
 /* Every PC has two 8259A Programmable Interrupt Controller (PIC)
@@ -360,11 +413,16 @@ intr_handler (struct intr_frame *frame)
   bool external;
   intr_handler_func *handler;
 
+  /* Only one processor at a time runs the kernel.  This takes
+     the big kernel lock unless the processor was in the kernel
+     already. */
+  mp_enter_kernel ();
+
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
-     and they need to be acknowledged on the PIC (see below).
-     An external interrupt handler cannot sleep. */
-  external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+     and they need to be acknowledged on the PIC or local APIC
+     (see below).  An external interrupt handler cannot sleep. */
+  external = is_external (frame->vec_no);
   if (external)
     {
       ASSERT (intr_get_level () == INTR_OFF);
@@ -378,7 +436,8 @@ intr_handler (struct intr_frame *frame)
   handler = intr_handlers[frame->vec_no];
   if (handler != NULL)
     handler (frame);
-  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
+  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+           || frame->vec_no == LAPIC_SPURIOUS_VEC)
     {
       /* There is no handler, but this interrupt can trigger
          spuriously due to a hardware fault or hardware race
@@ -399,11 +458,98 @@ intr_handler (struct intr_frame *frame)
       ASSERT (intr_context ());
 
       in_external_intr = false;
-      pic_end_of_interrupt (frame->vec_no);
-
+      if (frame->vec_no < 0x30)
+        pic_end_of_interrupt (frame->vec_no);
+      else
+        lapic_eoi ();
+
+      /* Give other processors a turn in the kernel, as a thread
+         switch here would.  Their interrupts reset
+         yield_on_return, so keep ours.  Softirqs are left to
+         finish first, since the others would find them running. */
+      if ((frame->cs & 3) == 0 && !in_softirq)
+        {
+          bool yield = yield_on_return;
+
+          mp_relax ();
+          yield_on_return = yield;
+        }
+
+      if (softirq_cnt > 0 && !in_softirq)
+        {
+          /* Interrupts that come in meanwhile reset yield_on_return
+             for themselves, so keep ours. */
+          bool yield = yield_on_return;
+
+          run_softirqs ();
+          yield_on_return = yield || yield_after_softirq;
+        }
+
+      /* Switching threads in the middle of softirqs would hold
+         them up until this thread runs again.  An interrupt that
+         came in during them leaves the yield to the interrupt
+         that is running them. */
       if (yield_on_return)
-        thread_yield ();
+        {
+          if (in_softirq)
+            yield_after_softirq = true;
+          else
+            thread_yield ();
+        }
+    }
+
+  /* Let other processors into the kernel while this one runs
+     user code.  The thread may have moved to another processor
+     while it yielded, so it is that one's lock to release. */
+  if ((frame->cs & 3) != 0)
+    {
+      intr_disable ();
+      mp_leave_kernel ();
+    }
+}
+
+/* Asks for FUNC to be called with interrupts on once the
+   current external interrupt has been handled.  Raising a
+   function that is already pending has no effect.  May only be
+   called from an external interrupt handler. */
+void
+intr_raise_softirq (intr_softirq_func *func)
+{
+  int i;
+
+  ASSERT (intr_context ());
+
+  for (i = 0; i < softirq_cnt; i++)
+    if (softirqs[i] == func)
+      return;
+  ASSERT (softirq_cnt < SOFTIRQ_CNT);
+  softirqs[softirq_cnt++] = func;
+}
+
+/* Calls the raised softirq functions, with interrupts on, until
+   none are left.  Interrupts must be off on entry and are off
+   again on return. */
+static void
+run_softirqs (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  in_softirq = true;
+  yield_after_softirq = false;
+  while (softirq_cnt > 0)
+    {
+      intr_softirq_func *func = softirqs[0];
+      int i;
+
+      for (i = 1; i < softirq_cnt; i++)
+        softirqs[i - 1] = softirqs[i];
+      softirq_cnt--;
+
+      intr_enable ();
+      func ();
+      intr_disable ();
     }
+  in_softirq = false;
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
@@ -57,7 +57,11 @@ struct intr_frame
 
 typedef void intr_handler_func (struct intr_frame *);
 
+/* Deferred work raised by an external interrupt handler. */
+typedef void intr_softirq_func (void);
+
 void intr_init (void);
+void intr_init_ap (void);
 void intr_register_ext (uint8_t vec, intr_handler_func *, const char *name);
 void intr_register_int (uint8_t vec, int dpl, enum intr_level,
                         intr_handler_func *, const char *name);
@@ -65,6 +69,8 @@ intr_handler_func *intr_bypass_int(uint8_t vec, intr_handler_func *);
 void intr_clear_int (uint8_t vec);
 bool intr_context (void);
 void intr_yield_on_return (void);
+bool intr_defer_yield (void);
+void intr_raise_softirq (intr_softirq_func *);
 
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
@@ -0,0 +1,237 @@
+#include "threads/lapic.h"
+#include <debug.h>
+#include <stdbool.h>
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Local APIC, the interrupt controller that each processor has
+   for itself.  Pintos leaves device interrupts to the 8259A PICs,
+   which the BIOS wires to the bootstrap processor, and uses the
+   local APICs only to start the application processors, to send
+   interrupts between processors, and as the timer of the
+   application processors.
+
+   See [IA32-v3a] chapter 10 "Advanced Programmable Interrupt
+   Controller (APIC)". */
+
+/* Register offsets, in bytes. */
+#define LAPIC_ID        0x020   /* Local APIC ID. */
+#define LAPIC_TPR       0x080   /* Task priority. */
+#define LAPIC_EOI       0x0b0   /* End of interrupt. */
+#define LAPIC_SVR       0x0f0   /* Spurious interrupt vector. */
+#define LAPIC_ESR       0x280   /* Error status. */
+#define LAPIC_ICR_LO    0x300   /* Interrupt command, low half. */
+#define LAPIC_ICR_HI    0x310   /* Interrupt command, high half. */
+#define LAPIC_TIMER     0x320   /* Local vector table: timer. */
+#define LAPIC_LINT0     0x350   /* Local vector table: LINT0 pin. */
+#define LAPIC_LINT1     0x360   /* Local vector table: LINT1 pin. */
+#define LAPIC_ERROR     0x370   /* Local vector table: errors. */
+#define LAPIC_TIMER_INIT 0x380  /* Timer initial count. */
+#define LAPIC_TIMER_CUR 0x390   /* Timer current count. */
+#define LAPIC_TIMER_DIV 0x3e0   /* Timer divide configuration. */
+
+/* Register bits. */
+#define SVR_ENABLE      0x00000100 /* APIC software enable. */
+#define LVT_MASKED      0x00010000 /* Interrupt masked. */
+#define LVT_PERIODIC    0x00020000 /* Timer reloads itself. */
+#define ICR_INIT        0x00000500 /* Delivery mode: INIT. */
+#define ICR_STARTUP     0x00000600 /* Delivery mode: start-up. */
+#define ICR_PENDING     0x00001000 /* Delivery status: send pending. */
+#define ICR_ASSERT      0x00004000 /* Level: assert. */
+#define ICR_LEVEL       0x00008000 /* Trigger mode: level. */
+#define TIMER_DIV_16    0x3        /* Timer counts at bus clock / 16. */
+
+/* Virtual address of the registers.  They are mapped at their
+   physical address, which is far above the RAM mapped at
+   PHYS_BASE. */
+static volatile uint32_t *lapic;
+
+/* Timer counts per timer tick.  Set by lapic_timer_calibrate(). */
+static uint32_t counts_per_tick;
+
+static intr_handler_func lapic_timer_interrupt;
+
+/* Reads the register at byte offset REG. */
+static uint32_t
+lapic_read (int reg)
+{
+  return lapic[reg / sizeof *lapic];
+}
+
+/* Writes VALUE to the register at byte offset REG. */
+static void
+lapic_write (int reg, uint32_t value)
+{
+  lapic[reg / sizeof *lapic] = value;
+}
+
+/* Maps the local APIC registers, which are at physical address
+   PADDR, into the kernel's address space, and enables the
+   bootstrap processor's local APIC.  Must be called after
+   paging_init() and before any process exists, because page
+   directories copy the kernel mappings of base_page_dir when
+   they are created. */
+void
+lapic_init (uintptr_t paddr)
+{
+  uint32_t *pde, *pt;
+
+  ASSERT (pg_ofs ((void *) paddr) == 0);
+  ASSERT ((uintptr_t) ptov (ram_pages * PGSIZE) <= paddr);
+
+  pde = base_page_dir + pd_no ((void *) paddr);
+  if (*pde == 0)
+    {
+      pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+      *pde = pde_create (pt);
+    }
+  else
+    pt = pde_get_pt (*pde);
+
+  /* Device registers must not be cached. */
+  pt[pt_no ((void *) paddr)] = paddr | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+  lapic = (volatile uint32_t *) paddr;
+
+  lapic_enable ();
+}
+
+/* Enables the running processor's local APIC.  The LINT0 and
+   LINT1 pins keep the setup the BIOS gave them, which on the
+   bootstrap processor passes the PICs' interrupts through. */
+void
+lapic_enable (void)
+{
+  ASSERT (lapic != NULL);
+
+  lapic_write (LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS_VEC);
+  lapic_write (LAPIC_TIMER, LVT_MASKED | LAPIC_TIMER_VEC);
+  lapic_write (LAPIC_ERROR, LVT_MASKED);
+
+  /* Clear errors (the register must be written before it is
+     read), and accept interrupts of every priority. */
+  lapic_write (LAPIC_ESR, 0);
+  lapic_write (LAPIC_ESR, 0);
+  lapic_write (LAPIC_TPR, 0);
+}
+
+/* Returns the running processor's local APIC ID. */
+uint8_t
+lapic_id (void)
+{
+  return lapic_read (LAPIC_ID) >> 24;
+}
+
+/* Acknowledges the interrupt being handled, so that the local
+   APIC can deliver the next one. */
+void
+lapic_eoi (void)
+{
+  lapic_write (LAPIC_EOI, 0);
+}
+
+/* Sends the command LO to the local APIC with ID LAPIC_ID and
+   waits until the local APIC has sent it. */
+static void
+send_command (uint8_t lapic_id, uint32_t lo)
+{
+  lapic_write (LAPIC_ICR_HI, (uint32_t) lapic_id << 24);
+  lapic_write (LAPIC_ICR_LO, lo);
+  while (lapic_read (LAPIC_ICR_LO) & ICR_PENDING)
+    asm volatile ("pause");
+}
+
+/* Sends interrupt VEC to the processor whose local APIC has ID
+   LAPIC_ID.  Interrupts must be off, so that nothing else uses
+   the interrupt command register meanwhile. */
+void
+lapic_send_ipi (uint8_t lapic_id, uint8_t vec)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  send_command (lapic_id, vec);
+}
+
+/* Starts the application processor whose local APIC has ID
+   LAPIC_ID running real-mode code at physical address PADDR,
+   which must be page-aligned and below 1 MB.  Sleeps, so it must
+   be called from a thread.
+
+   This is the INIT-SIPI-SIPI sequence of [MP] appendix B.4. */
+void
+lapic_start_ap (uint8_t lapic_id, uintptr_t paddr)
+{
+  enum intr_level old_level;
+  int i;
+
+  ASSERT (pg_ofs ((void *) paddr) == 0 && paddr < 0x100000);
+
+  old_level = intr_disable ();
+  send_command (lapic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+  send_command (lapic_id, ICR_INIT | ICR_LEVEL);
+  intr_set_level (old_level);
+  timer_msleep (10);
+
+  for (i = 0; i < 2; i++)
+    {
+      old_level = intr_disable ();
+      send_command (lapic_id, ICR_STARTUP | (paddr >> 12));
+      intr_set_level (old_level);
+      timer_usleep (200);
+    }
+}
+
+/* Measures how fast the local APIC timer counts against the
+   8254 timer, and registers the handler of the local timer.
+   Busy-waits for a tenth of a second, so it must be called with
+   interrupts on, after timer_calibrate(). */
+void
+lapic_timer_calibrate (void)
+{
+  int64_t tick_cnt = TIMER_FREQ / 10 > 2 ? TIMER_FREQ / 10 : 2;
+  int64_t start;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  /* Count down from the top in one-shot mode, with the interrupt
+     masked, for TICK_CNT whole ticks. */
+  lapic_write (LAPIC_TIMER_DIV, TIMER_DIV_16);
+  lapic_write (LAPIC_TIMER, LVT_MASKED | LAPIC_TIMER_VEC);
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    barrier ();
+  start = timer_ticks ();
+  lapic_write (LAPIC_TIMER_INIT, 0xffffffff);
+  while (timer_ticks () < start + tick_cnt)
+    barrier ();
+  counts_per_tick = (0xffffffff - lapic_read (LAPIC_TIMER_CUR)) / tick_cnt;
+  lapic_write (LAPIC_TIMER_INIT, 0);
+
+  intr_register_ext (LAPIC_TIMER_VEC, lapic_timer_interrupt, "LAPIC Timer");
+}
+
+/* Starts the running processor's local APIC timer, interrupting
+   TIMER_FREQ times per second. */
+void
+lapic_timer_start (void)
+{
+  ASSERT (counts_per_tick != 0);
+
+  lapic_write (LAPIC_TIMER_DIV, TIMER_DIV_16);
+  lapic_write (LAPIC_TIMER, LVT_PERIODIC | LAPIC_TIMER_VEC);
+  lapic_write (LAPIC_TIMER_INIT, counts_per_tick);
+}
+
+/* Local timer interrupt handler.  Only application processors
+   run their timer: the bootstrap processor's ticks come from the
+   8254, which also keeps the time. */
+static void
+lapic_timer_interrupt (struct intr_frame *args UNUSED)
+{
+  thread_tick ();
+}
@@ -0,0 +1,21 @@
+#ifndef THREADS_LAPIC_H
+#define THREADS_LAPIC_H
+
+#include <stdint.h>
+
+/* Interrupt vectors of the local APIC.  The timer and the IPIs
+   are external interrupts, like those from the PICs. */
+#define LAPIC_TIMER_VEC 0x40    /* Local timer, on application CPUs. */
+#define IPI_RESCHEDULE 0x41     /* A thread became ready here. */
+#define LAPIC_SPURIOUS_VEC 0xff /* Spurious interrupt, ignored. */
+
+void lapic_init (uintptr_t paddr);
+void lapic_enable (void);
+uint8_t lapic_id (void);
+void lapic_eoi (void);
+void lapic_send_ipi (uint8_t lapic_id, uint8_t vec);
+void lapic_start_ap (uint8_t lapic_id, uintptr_t paddr);
+void lapic_timer_calibrate (void);
+void lapic_timer_start (void);
+
+#endif /* threads/lapic.h */
@@ -5,6 +5,10 @@
 #define LOADER_BASE 0x7c00      /* Physical address of loader's base. */
 #define LOADER_END  0x7e00      /* Physical address of end of loader. */
 
+/* Physical address that application processors start at.  Free
+   memory between the loader and its temporary page tables. */
+#define LOADER_AP_BASE 0x8000
+
 /* Physical address of kernel base. */
 #define LOADER_KERN_BASE 0x100000       /* 1 MB. */
 
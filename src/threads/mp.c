@@ -0,0 +1,416 @@
+#include "threads/mp.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/lapic.h"
+#include "threads/loader.h"
+#include "threads/pte.h"
+#include "threads/spinlock.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#endif
+
+/* Symmetric multiprocessing.
+
+   mp_init() finds the processors in the MultiProcessor
+   Specification tables that the BIOS leaves in low memory, and
+   mp_start() starts the application processors (APs) through
+   their local APICs.  Each processor then runs its own scheduler
+   on its own run queue, see thread.c.
+
+   Most of the kernel still assumes that it runs on one processor
+   at a time: it protects its data by turning interrupts off.  So
+   a processor takes the big kernel lock whenever it enters the
+   kernel, and releases it only when it returns to user mode or
+   halts in its idle thread.  User programs run in parallel, the
+   kernel does not.
+
+   Kernel code that runs with interrupts on is already written to
+   be preempted at any instruction, so an external interrupt that
+   arrives while it runs may also pass the lock to a waiting
+   processor and take it back afterward (see mp_relax()).  Without
+   that, a kernel thread that waits for the timer by spinning
+   would keep the bootstrap processor from ever taking the timer
+   interrupt that it waits for.
+
+   [MP] Intel, "MultiProcessor Specification", version 1.4. */
+
+int mp_cpu_cnt = 1;
+
+struct cpu cpus[CPU_MAX];
+int cpu_cnt = 1;
+
+/* The big kernel lock. */
+static struct spinlock kernel_lock;
+
+/* Physical address of the local APICs' registers, or 0 if there
+   is no MP configuration. */
+static uintptr_t lapic_paddr;
+
+/* Local APIC IDs of the application processors. */
+static uint8_t ap_lapic_ids[CPU_MAX - 1];
+static int ap_cnt;
+
+/* Start-up code, see mpboot.S. */
+extern char mpboot_start[], mpboot_end[];
+extern char mpboot_gdtr[], mpboot_cr3[], mpboot_stack[];
+
+/* MP floating pointer structure. */
+struct mp_float
+  {
+    char signature[4];          /* "_MP_". */
+    uint32_t config_paddr;      /* Physical address of config table. */
+    uint8_t length;             /* Length in 16-byte units. */
+    uint8_t spec_rev;           /* Specification revision. */
+    uint8_t checksum;           /* All bytes must add up to 0. */
+    uint8_t features[5];        /* Nonzero features[0]: default config. */
+  };
+
+/* MP configuration table header. */
+struct mp_config
+  {
+    char signature[4];          /* "PCMP". */
+    uint16_t length;            /* Base table length in bytes. */
+    uint8_t spec_rev;           /* Specification revision. */
+    uint8_t checksum;           /* All bytes must add up to 0. */
+    char oem_id[8];
+    char product_id[12];
+    uint32_t oem_table_paddr;
+    uint16_t oem_table_size;
+    uint16_t entry_cnt;         /* Number of entries after header. */
+    uint32_t lapic_paddr;       /* Local APIC address. */
+    uint16_t ext_length;
+    uint8_t ext_checksum;
+    uint8_t reserved;
+  };
+
+/* Configuration table entry types and sizes. */
+#define MP_PROCESSOR 0          /* Processor entry, 20 bytes. */
+#define MP_ENTRY_SIZE 8         /* Size of every other entry. */
+
+/* Processor entry. */
+struct mp_processor
+  {
+    uint8_t type;               /* MP_PROCESSOR. */
+    uint8_t lapic_id;           /* Local APIC ID. */
+    uint8_t lapic_version;
+    uint8_t flags;              /* MP_CPU_* flags. */
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+  };
+
+#define MP_CPU_ENABLED 0x01     /* Processor is usable. */
+#define MP_CPU_BSP 0x02         /* Bootstrap processor. */
+
+/* Local APIC address of the default configurations. */
+#define DEFAULT_LAPIC_PADDR 0xfee00000
+
+static void add_ap (uint8_t lapic_id);
+static bool start_ap (struct cpu *, uint8_t lapic_id);
+static intr_handler_func reschedule_interrupt;
+static const struct mp_float *find_mp_float (void);
+static const struct mp_float *scan (uintptr_t paddr, size_t size);
+static bool phys_ok (uintptr_t paddr, size_t size);
+static uint8_t sum (const void *, size_t);
+
+/* Finds out how many processors the machine has, sets mp_cpu_cnt
+   and reports it, and enables the local APIC of the bootstrap
+   processor, which from now on holds the big kernel lock.  Must
+   be called after paging_init(). */
+void
+mp_init (void)
+{
+  const struct mp_float *mpf = find_mp_float ();
+  const struct mp_config *conf;
+  const uint8_t *p, *end;
+  int cnt = 0;
+
+  /* The structures have no padding to remove. */
+  ASSERT (sizeof (struct mp_float) == 16);
+  ASSERT (sizeof (struct mp_config) == 44);
+  ASSERT (sizeof (struct mp_processor) == 20);
+
+  spinlock_init (&kernel_lock, "kernel");
+  spinlock_acquire (&kernel_lock);
+
+  if (mpf == NULL)
+    return;
+
+  if (mpf->features[0] != 0)
+    {
+      /* One of the default configurations, which all have two
+         processors, with local APIC IDs 0 and 1. */
+      lapic_paddr = DEFAULT_LAPIC_PADDR;
+      lapic_init (lapic_paddr);
+      add_ap (lapic_id () == 0 ? 1 : 0);
+      cnt = 2;
+    }
+  else
+    {
+      if (!phys_ok (mpf->config_paddr, sizeof *conf))
+        return;
+      conf = ptov (mpf->config_paddr);
+      if (memcmp (conf->signature, "PCMP", 4)
+          || !phys_ok (mpf->config_paddr, conf->length)
+          || sum (conf, conf->length) != 0)
+        return;
+
+      p = (const uint8_t *) (conf + 1);
+      end = (const uint8_t *) conf + conf->length;
+      while (p < end)
+        if (*p == MP_PROCESSOR)
+          {
+            const struct mp_processor *cpu = (const void *) p;
+            if (cpu->flags & MP_CPU_ENABLED)
+              {
+                if (!(cpu->flags & MP_CPU_BSP))
+                  add_ap (cpu->lapic_id);
+                cnt++;
+              }
+            p += sizeof *cpu;
+          }
+        else
+          p += MP_ENTRY_SIZE;
+
+      if (cnt > 1)
+        {
+          lapic_paddr = conf->lapic_paddr;
+          lapic_init (lapic_paddr);
+        }
+    }
+
+  if (cnt > 1)
+    {
+      mp_cpu_cnt = cnt;
+      cpus[0].lapic_id = lapic_id ();
+      printf ("Found %d processors, using %d.\n", cnt, ap_cnt + 1);
+    }
+}
+
+/* Starts the application processors found by mp_init().  Must be
+   called from the initial thread after timer_calibrate(), and
+   before the first process is created. */
+void
+mp_start (void)
+{
+  uint32_t *pd = base_page_dir;
+  uint8_t *code = ptov (LOADER_AP_BASE);
+  uint64_t gdtr;
+  int i;
+
+  if (ap_cnt == 0)
+    return;
+
+  lapic_timer_calibrate ();
+  intr_register_ext (IPI_RESCHEDULE, reschedule_interrupt, "Reschedule IPI");
+
+  /* Copy the start-up code and tell it the page directory and
+     GDT to use. */
+  memcpy (code, mpboot_start, mpboot_end - mpboot_start);
+  asm volatile ("sgdt %0" : "=m" (gdtr));
+  memcpy (code + (mpboot_gdtr - mpboot_start), &gdtr, 6);
+  *(uint32_t *) (code + (mpboot_cr3 - mpboot_start)) = vtop (pd);
+
+  /* The start-up code turns on paging while it still runs at its
+     physical address, so for the time being map the bottom 4 MB
+     of memory at virtual address 0 too.  No process exists yet,
+     so this is the only page directory. */
+  pd[0] = pd[pd_no (PHYS_BASE)];
+
+  for (i = 0; i < ap_cnt; i++)
+    if (!start_ap (&cpus[cpu_cnt], ap_lapic_ids[i]))
+      PANIC ("processor with local APIC ID %d did not start",
+             ap_lapic_ids[i]);
+
+  pd[0] = 0;
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
+}
+
+/* Starts the application processor whose local APIC has ID
+   LAPIC_ID as processor C and waits for it to come up.  Returns
+   true if it did within a second. */
+static bool
+start_ap (struct cpu *c, uint8_t lapic_id)
+{
+  uint8_t *code = ptov (LOADER_AP_BASE);
+  struct thread *idle;
+  int i;
+
+  c->lapic_id = lapic_id;
+  idle = thread_create_idle (c);
+  if (idle == NULL)
+    PANIC ("out of memory starting processor %d", c->id);
+  *(uint32_t *) (code + (mpboot_stack - mpboot_start))
+    = (uint32_t) idle + PGSIZE;
+
+  lapic_start_ap (lapic_id, LOADER_AP_BASE);
+  for (i = 0; i < 100 && !c->started; i++)
+    timer_msleep (10);
+  if (!c->started)
+    return false;
+
+  cpu_cnt++;
+  return true;
+}
+
+/* Entry point of the application processors, called by mpboot.S
+   on the processor's idle thread's stack, with paging on and
+   interrupts off.  Sets up the processor's interrupts and
+   segments, then runs its idle thread. */
+void
+mp_ap_main (void)
+{
+  struct cpu *c = cpu_current ();
+
+  intr_init_ap ();
+#ifdef USERPROG
+  gdt_init_ap ();
+#endif
+  lapic_enable ();
+  lapic_timer_start ();
+
+  /* mp_start() waits for this, while it may hold the kernel
+     lock. */
+  c->started = true;
+
+  mp_enter_kernel ();
+  thread_start_ap ();
+}
+
+/* Takes the big kernel lock, unless the running processor holds
+   it already.  Called whenever a processor enters the kernel. */
+void
+mp_enter_kernel (void)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (!spinlock_held (&kernel_lock))
+    spinlock_acquire (&kernel_lock);
+  intr_set_level (old_level);
+}
+
+/* Releases the big kernel lock, if the running processor holds
+   it.  Interrupts must be off, and stay off until the processor
+   has left the kernel, or it would run kernel code without the
+   lock. */
+void
+mp_leave_kernel (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (spinlock_held (&kernel_lock))
+    spinlock_release (&kernel_lock);
+}
+
+/* Lets any processor that waits for the big kernel lock have it
+   before the running processor takes it back.  Called at the end
+   of an external interrupt that interrupted kernel code, which
+   had interrupts on and so can tolerate other kernel code running
+   meanwhile, just as if the interrupt had switched threads. */
+void
+mp_relax (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (spinlock_held (&kernel_lock));
+
+  if (spinlock_contended (&kernel_lock))
+    {
+      spinlock_release (&kernel_lock);
+      spinlock_acquire (&kernel_lock);
+    }
+}
+
+/* Interrupts processor C, so that it checks whether a thread on
+   its run queue should preempt the thread it is running.
+   Interrupts must be off. */
+void
+mp_reschedule (struct cpu *c)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (c != cpu_current ());
+
+  lapic_send_ipi (c->lapic_id, IPI_RESCHEDULE);
+}
+
+/* Reschedule IPI handler. */
+static void
+reschedule_interrupt (struct intr_frame *args UNUSED)
+{
+  cpu_current ()->ipi_cnt++;
+  thread_preempt ();
+}
+
+/* Records the application processor whose local APIC has ID
+   LAPIC_ID, unless there are as many as Pintos uses. */
+static void
+add_ap (uint8_t lapic_id)
+{
+  if (ap_cnt < CPU_MAX - 1)
+    ap_lapic_ids[ap_cnt++] = lapic_id;
+}
+
+/* Searches the places where [MP] says the floating pointer
+   structure may be: the first kB of the extended BIOS data area,
+   the last kB of base memory, and the BIOS ROM. */
+static const struct mp_float *
+find_mp_float (void)
+{
+  uintptr_t ebda = *(uint16_t *) ptov (0x40e) << 4;
+  uintptr_t base_kb = *(uint16_t *) ptov (0x413);
+  const struct mp_float *mpf = NULL;
+
+  if (ebda != 0)
+    mpf = scan (ebda, 1024);
+  if (mpf == NULL && base_kb != 0)
+    mpf = scan (base_kb * 1024 - 1024, 1024);
+  if (mpf == NULL)
+    mpf = scan (0xf0000, 0x10000);
+  return mpf;
+}
+
+/* Returns the MP floating pointer structure in the SIZE bytes of
+   physical memory starting at PADDR, or a null pointer. */
+static const struct mp_float *
+scan (uintptr_t paddr, size_t size)
+{
+  const uint8_t *p, *end;
+
+  if (!phys_ok (paddr, size))
+    return NULL;
+  p = ptov (paddr);
+  end = p + size;
+  for (; p + sizeof (struct mp_float) <= end; p += 16)
+    if (!memcmp (p, "_MP_", 4) && sum (p, sizeof (struct mp_float)) == 0)
+      return (const struct mp_float *) p;
+  return NULL;
+}
+
+/* Returns true if the SIZE bytes of physical memory starting at
+   PADDR are mapped into the kernel's address space. */
+static bool
+phys_ok (uintptr_t paddr, size_t size)
+{
+  uintptr_t limit = ram_pages * PGSIZE;
+  return paddr < limit && size <= limit - paddr;
+}
+
+/* Returns the sum of the SIZE bytes at P, modulo 256. */
+static uint8_t
+sum (const void *p_, size_t size)
+{
+  const uint8_t *p = p_;
+  uint8_t s = 0;
+
+  while (size-- > 0)
+    s += *p++;
+  return s;
+}
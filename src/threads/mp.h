@@ -0,0 +1,21 @@
+#ifndef THREADS_MP_H
+#define THREADS_MP_H
+
+#include <debug.h>
+
+struct cpu;
+
+/* Number of processors listed as usable by the BIOS, or 1 if the
+   machine has no MP configuration table.  Set by mp_init(). */
+extern int mp_cpu_cnt;
+
+void mp_init (void);
+void mp_start (void);
+void mp_ap_main (void) NO_RETURN;
+
+void mp_enter_kernel (void);
+void mp_leave_kernel (void);
+void mp_relax (void);
+void mp_reschedule (struct cpu *);
+
+#endif /* threads/mp.h */
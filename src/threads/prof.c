@@ -0,0 +1,159 @@
+#include "threads/prof.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/serial.h"
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Size of the histogram, in pages. */
+#define PROF_PAGES 8
+
+/* Maximum number of user processes whose names are remembered. */
+#define PROF_THREAD_CNT 64
+
+bool prof_enabled;
+
+/* Histogram bucket: the number of samples taken at EIP while
+   running user process TID, or in the kernel if TID is 0. */
+struct prof_bucket
+  {
+    uint32_t eip;
+    tid_t tid;
+    uint32_t cnt;               /* 0 if the bucket is unused. */
+  };
+
+static struct prof_bucket *buckets;     /* Hash table, or null. */
+static unsigned bucket_mask;            /* Number of buckets - 1. */
+static long long sample_cnt;            /* Samples taken. */
+static long long dropped_cnt;           /* Samples lost, table full. */
+
+/* Names of the user processes seen, so that samples can be matched
+   with program binaries after the processes are gone. */
+static struct
+  {
+    tid_t tid;
+    char name[16];
+  }
+threads[PROF_THREAD_CNT];
+static int thread_cnt;
+
+static void remember_thread (const struct thread *);
+
+/* Allocates the histogram if profiling was requested.  Must be
+   called after palloc_init(). */
+void
+prof_init (void)
+{
+  size_t cnt;
+
+  if (!prof_enabled)
+    return;
+
+  buckets = palloc_get_multiple (PAL_ZERO, PROF_PAGES);
+  if (buckets == NULL)
+    {
+      printf ("prof: out of memory, profiling disabled\n");
+      prof_enabled = false;
+      return;
+    }
+
+  /* Largest power of two that fits. */
+  cnt = PROF_PAGES * PGSIZE / sizeof *buckets;
+  while (cnt & (cnt - 1))
+    cnt &= cnt - 1;
+  bucket_mask = cnt - 1;
+}
+
+/* Records a sample of the code interrupted by the timer, whose
+   state is in FRAME.  Called by the timer interrupt handler. */
+void
+prof_sample (const struct intr_frame *frame)
+{
+  uint32_t eip = (uint32_t) frame->eip;
+  tid_t tid = 0;
+  unsigned i, probes;
+
+  if (buckets == NULL)
+    return;
+
+  if (is_user_vaddr (frame->eip))
+    {
+      struct thread *t = thread_current ();
+      tid = t->tid;
+      remember_thread (t);
+    }
+
+  sample_cnt++;
+  i = ((eip >> 2) ^ (tid * 2654435761u)) & bucket_mask;
+  for (probes = 0; probes <= bucket_mask; probes++, i = (i + 1) & bucket_mask)
+    {
+      struct prof_bucket *b = &buckets[i];
+      if (b->cnt == 0)
+        {
+          b->eip = eip;
+          b->tid = tid;
+        }
+      else if (b->eip != eip || b->tid != tid)
+        continue;
+      b->cnt++;
+      return;
+    }
+  dropped_cnt++;
+}
+
+/* Stops profiling and writes the histogram to the serial port,
+   between "PROF-BEGIN" and "PROF-END" lines. */
+void
+prof_dump (void)
+{
+  char line[64];
+  unsigned i;
+  int j;
+
+  if (buckets == NULL)
+    return;
+  prof_enabled = false;
+
+  snprintf (line, sizeof line, "PROF-BEGIN %lld %lld %d\n",
+            sample_cnt, dropped_cnt, TIMER_FREQ);
+  serial_puts (line);
+  for (j = 0; j < thread_cnt; j++)
+    {
+      snprintf (line, sizeof line, "PROF-THREAD %d %s\n",
+                threads[j].tid, threads[j].name);
+      serial_puts (line);
+    }
+  for (i = 0; i <= bucket_mask; i++)
+    if (buckets[i].cnt != 0)
+      {
+        snprintf (line, sizeof line, "%08x %d %u\n",
+                  buckets[i].eip, buckets[i].tid, buckets[i].cnt);
+        serial_puts (line);
+      }
+  serial_puts ("PROF-END\n");
+  buckets = NULL;
+}
+
+/* Remembers the name of user process T.  The most recent
+   process is checked first, so this is cheap while the same
+   process keeps running. */
+static void
+remember_thread (const struct thread *t)
+{
+  int j;
+
+  for (j = thread_cnt - 1; j >= 0; j--)
+    if (threads[j].tid == t->tid)
+      return;
+  if (thread_cnt < PROF_THREAD_CNT)
+    {
+      threads[thread_cnt].tid = t->tid;
+      strlcpy (threads[thread_cnt].name, t->name,
+               sizeof threads[thread_cnt].name);
+      thread_cnt++;
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef THREADS_PROF_H
+#define THREADS_PROF_H
+
+#include <stdbool.h>
+#include "threads/interrupt.h"
+
+/* Sampling profiler.
+
+   With the "-prof" kernel option, every timer interrupt records
+   the interrupted instruction and the user process it belongs to,
+   if any, in a histogram allocated at boot.  The histogram is
+   dumped to the serial port at power-off, where utils/pintos-prof
+   turns it into a flat profile. */
+
+/* Set by kernel command-line option "-prof". */
+extern bool prof_enabled;
+
+void prof_init (void);
+void prof_sample (const struct intr_frame *);
+void prof_dump (void);
+
+#endif /* threads/prof.h */
@@ -0,0 +1,82 @@
+#include "threads/spinlock.h"
+#include <debug.h>
+#include <stddef.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+
+/* Atomically adds 1 to *P and returns the old value.  The LOCK
+   prefix makes XADD a full memory barrier.  See [IA32-v2b]
+   "XADD". */
+static inline unsigned
+fetch_and_inc (volatile unsigned *p)
+{
+  unsigned old = 1;
+  asm volatile ("lock xaddl %0, %1" : "+r" (old), "+m" (*p) : : "memory");
+  return old;
+}
+
+/* Initializes LOCK, named NAME for debugging, as not held. */
+void
+spinlock_init (struct spinlock *lock, const char *name)
+{
+  ASSERT (lock != NULL);
+
+  lock->next = lock->owner = 0;
+  lock->cpu = NULL;
+  lock->name = name;
+}
+
+/* Acquires LOCK, spinning until it is available.  Interrupts
+   must be off, and the running processor must not hold LOCK
+   already. */
+void
+spinlock_acquire (struct spinlock *lock)
+{
+  unsigned ticket;
+
+  ASSERT (lock != NULL);
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!spinlock_held (lock));
+
+  /* Spin on plain reads, which stay in this processor's cache.
+     PAUSE tells the processor that this is a spin loop.  See
+     [IA32-v2b] "PAUSE". */
+  ticket = fetch_and_inc (&lock->next);
+  while (lock->owner != ticket)
+    asm volatile ("pause");
+  barrier ();
+  lock->cpu = cpu_current ();
+}
+
+/* Releases LOCK, which the running processor must hold. */
+void
+spinlock_release (struct spinlock *lock)
+{
+  ASSERT (lock != NULL);
+  ASSERT (spinlock_held (lock));
+
+  lock->cpu = NULL;
+  barrier ();
+  lock->owner++;
+}
+
+/* Returns true if the running processor holds LOCK.  Interrupts
+   must be off, or the answer may be stale by the time the caller
+   sees it. */
+bool
+spinlock_held (const struct spinlock *lock)
+{
+  ASSERT (lock != NULL);
+
+  return lock->cpu == cpu_current ();
+}
+
+/* Returns true if some processor is waiting for LOCK. */
+bool
+spinlock_contended (const struct spinlock *lock)
+{
+  ASSERT (lock != NULL);
+
+  return lock->next - lock->owner > 1;
+}
@@ -0,0 +1,29 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <stdbool.h>
+
+struct cpu;
+
+/* A lock that waits by spinning, for data that processors share.
+   Interrupts must be off while a spinlock is held, so that its
+   holder can neither be switched out nor interrupted by a handler
+   that wants the same lock.
+
+   Processors get the lock in the order they asked for it: each
+   takes a ticket and waits until `owner' reaches it. */
+struct spinlock
+  {
+    volatile unsigned next;     /* Next ticket to hand out. */
+    volatile unsigned owner;    /* Ticket of the holder. */
+    struct cpu *cpu;            /* Holding processor, or NULL. */
+    const char *name;           /* Name, for debugging. */
+  };
+
+void spinlock_init (struct spinlock *, const char *name);
+void spinlock_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *);
+bool spinlock_held (const struct spinlock *);
+bool spinlock_contended (const struct spinlock *);
+
+#endif /* threads/spinlock.h */
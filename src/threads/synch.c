@@ -29,8 +29,29 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+
+/* Maximum length of a chain of nested priority donations.  Bounds
+   the walk in donate_priority() even if the lock holders form a
+   cycle, i.e. are deadlocked. */
+#define DONATION_DEPTH_MAX 8
+
+/* Statistics. */
+static long long inversion_cnt;     /* # of waits on a lower-priority holder. */
+static long long inversion_ticks;   /* # of timer ticks spent in such waits. */
+
+/* Named locks, whose contention profile is reported by
+   lock_print_stats() and lock_get_stats(). */
+#define LOCK_NAMED_MAX 64           /* Max # of named locks. */
+#define LOCK_PRINT_TOP 10           /* # of locks printed at power off. */
+static struct lock *named_locks[LOCK_NAMED_MAX];
+static int named_lock_cnt;
+
+static void donate_priority (struct lock *);
+static int sort_named_locks (struct lock **);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -75,6 +96,40 @@ sema_down (struct semaphore *sema)
   intr_set_level (old_level);
 }
 
+/* Like sema_down(), but gives up once TICKS timer ticks have
+   passed without SEMA becoming positive.  Returns true if SEMA
+   was decremented, false if the wait timed out.  The deadline is
+   kept by the timer, so a waiter that times out is woken by the
+   timer interrupt rather than by polling.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+sema_down_timeout (struct semaphore *sema, int64_t ticks)
+{
+  enum intr_level old_level;
+  int64_t deadline;
+
+  ASSERT (sema != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  deadline = timer_ticks () + ticks;
+  while (sema->value == 0)
+    {
+      if (timer_ticks () >= deadline)
+        {
+          intr_set_level (old_level);
+          return false;
+        }
+      list_push_back (&sema->waiters, &thread_current ()->elem);
+      timer_block_until (deadline);
+    }
+  sema->value--;
+  intr_set_level (old_level);
+  return true;
+}
+
 /* Down or "P" operation on a semaphore, but only if the
    semaphore is not already 0.  Returns true if the semaphore is
    decremented, false otherwise.
@@ -102,7 +157,8 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any.
 
    This function may be called from an interrupt handler. */
 void
@@ -114,10 +170,20 @@ sema_up (struct semaphore *sema)
 
   old_level = intr_disable ();
   if (!list_empty (&sema->waiters))
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
+    {
+      /* Wake the highest-priority waiter.  Among waiters of equal
+         priority, list_max() returns the one that has waited the
+         longest. */
+      struct list_elem *e = list_max (&sema->waiters,
+                                      thread_priority_less, NULL);
+      list_remove (e);
+      thread_unblock (list_entry (e, struct thread, elem));
+    }
   sema->value++;
   intr_set_level (old_level);
+
+  /* The woken thread may have a higher priority than we do. */
+  thread_preempt ();
 }
 
 static void sema_test_helper (void *sema_);
@@ -171,7 +237,12 @@ sema_test_helper (void *sema_)
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
+   instead of a lock.
+
+   Locks implement priority donation: a thread that blocks on a
+   lock lends its priority to the holder, and transitively to
+   whatever thread the holder is itself waiting for, until the
+   lock is released. */
 void
 lock_init (struct lock *lock)
 {
@@ -179,6 +250,33 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->name = NULL;
+}
+
+/* Initializes LOCK like lock_init(), and also gives it NAME and
+   starts keeping a contention profile for it: how often it is
+   acquired, how often and how long acquirers have to wait, and
+   for how long it is held.  The profile is printed at power off
+   and can be read with lock_get_stats().
+
+   NAME and LOCK must stay valid until the kernel powers off, so
+   this is meant for locks with static storage duration. */
+void
+lock_init_named (struct lock *lock, const char *name)
+{
+  enum intr_level old_level;
+
+  ASSERT (name != NULL);
+
+  lock_init (lock);
+  lock->name = name;
+  lock->acquire_cnt = lock->contended_cnt = 0;
+  lock->wait_ticks = lock->max_wait_ticks = lock->hold_ticks = 0;
+
+  old_level = intr_disable ();
+  if (named_lock_cnt < LOCK_NAMED_MAX)
+    named_locks[named_lock_cnt++] = lock;
+  intr_set_level (old_level);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -192,12 +290,81 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t inversion_start = -1;
+  int64_t wait_start = -1;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  TRACE (TRACE_LOCK_WAIT, lock,
+         lock->holder != NULL ? lock->holder->tid : TID_ERROR);
+  if (lock->holder != NULL)
+    {
+      if (lock->name != NULL)
+        wait_start = timer_ticks ();
+      if (lock->holder->priority < cur->priority)
+        {
+          inversion_cnt++;
+          inversion_start = timer_ticks ();
+        }
+      cur->waiting_lock = lock;
+      donate_priority (lock);
+    }
+
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+  list_push_back (&cur->locks, &lock->elem);
+  TRACE (TRACE_LOCK_ACQUIRED, lock, 0);
+  if (inversion_start >= 0)
+    inversion_ticks += timer_elapsed (inversion_start);
+  if (lock->name != NULL)
+    {
+      lock->acquired_at = timer_ticks ();
+      lock->acquire_cnt++;
+      if (wait_start >= 0)
+        {
+          int64_t waited = lock->acquired_at - wait_start;
+
+          lock->contended_cnt++;
+          lock->wait_ticks += waited;
+          if (waited > lock->max_wait_ticks)
+            lock->max_wait_ticks = waited;
+        }
+    }
+  intr_set_level (old_level);
+}
+
+/* Lends the current thread's priority to the holder of LOCK, and
+   follows the chain of locks that the holder, and in turn its
+   holder, is waiting for.  Interrupts must be off. */
+static void
+donate_priority (struct lock *lock)
+{
+  int priority = thread_current ()->priority;
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs)
+    return;
+
+  for (depth = 0; depth < DONATION_DEPTH_MAX; depth++)
+    {
+      struct thread *holder = lock->holder;
+      if (holder == NULL || holder->priority >= priority)
+        break;
+
+      thread_donate_priority (holder, priority);
+      lock = holder->waiting_lock;
+      if (lock == NULL)
+        break;
+    }
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -209,18 +376,31 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+      list_push_back (&lock->holder->locks, &lock->elem);
+      if (lock->name != NULL)
+        {
+          lock->acquired_at = timer_ticks ();
+          lock->acquire_cnt++;
+        }
+    }
+  intr_set_level (old_level);
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   Gives up any priority donated through LOCK, which may cause
+   the current thread to yield to the woken waiter.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
@@ -228,11 +408,23 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  TRACE (TRACE_LOCK_RELEASE, lock, 0);
+  if (lock->name != NULL)
+    lock->hold_ticks += timer_elapsed (lock->acquired_at);
   lock->holder = NULL;
+  list_remove (&lock->elem);
+  thread_update_priority (cur);
   sema_up (&lock->semaphore);
+  intr_set_level (old_level);
+
+  thread_preempt ();
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -245,14 +437,100 @@ lock_held_by_current_thread (const struct lock *lock)
 
   return lock->holder == thread_current ();
 }
+
+/* Prints priority inversion statistics and the contention
+   profile of the most contended named locks. */
+void
+lock_print_stats (void)
+{
+  struct lockstat stats[LOCK_PRINT_TOP];
+  int cnt, i;
+
+  printf ("Lock: %lld priority inversions, %lld ticks waiting on "
+          "lower-priority holders\n", inversion_cnt, inversion_ticks);
+
+  cnt = lock_get_stats (stats, LOCK_PRINT_TOP);
+  if (cnt == 0)
+    return;
+  printf ("Lock: %-15s %10s %10s %10s %8s %10s\n", "name", "acquired",
+          "contended", "wait", "max wait", "held");
+  for (i = 0; i < cnt; i++)
+    printf ("Lock: %-15s %10lld %10lld %10lld %8lld %10lld\n",
+            stats[i].name, stats[i].acquire_cnt, stats[i].contended_cnt,
+            stats[i].wait_ticks, stats[i].max_wait_ticks,
+            stats[i].hold_ticks);
+}
+
+/* Copies the contention profile of up to MAX named locks into
+   STATS, most contended first, and returns the number copied.
+   Locks are ordered by total wait time, then by number of
+   contended acquisitions. */
+int
+lock_get_stats (struct lockstat *stats, int max)
+{
+  struct lock *sorted[LOCK_NAMED_MAX];
+  enum intr_level old_level;
+  int cnt, i;
+
+  old_level = intr_disable ();
+  cnt = sort_named_locks (sorted);
+  if (cnt > max)
+    cnt = max;
+  for (i = 0; i < cnt; i++)
+    {
+      struct lock *l = sorted[i];
+
+      strlcpy (stats[i].name, l->name, sizeof stats[i].name);
+      stats[i].acquire_cnt = l->acquire_cnt;
+      stats[i].contended_cnt = l->contended_cnt;
+      stats[i].wait_ticks = l->wait_ticks;
+      stats[i].max_wait_ticks = l->max_wait_ticks;
+      stats[i].hold_ticks = l->hold_ticks;
+    }
+  intr_set_level (old_level);
+
+  return cnt;
+}
+
+/* Stores pointers to all named locks into SORTED, most contended
+   first, and returns their number.  Interrupts must be off. */
+static int
+sort_named_locks (struct lock **sorted)
+{
+  int i, j;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Insertion sort: there are only a few dozen named locks. */
+  for (i = 0; i < named_lock_cnt; i++)
+    {
+      struct lock *l = named_locks[i];
+
+      for (j = i; j > 0; j--)
+        {
+          struct lock *prev = sorted[j - 1];
+          if (prev->wait_ticks > l->wait_ticks
+              || (prev->wait_ticks == l->wait_ticks
+                  && prev->contended_cnt >= l->contended_cnt))
+            break;
+          sorted[j] = prev;
+        }
+      sorted[j] = l;
+    }
+  return named_lock_cnt;
+}
 
 /* One semaphore in a list. */
 struct semaphore_elem
   {
     struct list_elem elem;              /* List element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on semaphore. */
   };
 
+static bool semaphore_elem_less (const struct list_elem *,
+                                 const struct list_elem *, void *aux);
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -295,14 +573,55 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
 
   sema_init (&waiter.semaphore, 0);
+  waiter.thread = thread_current ();
   list_push_back (&cond->waiters, &waiter.elem);
   lock_release (lock);
   sema_down (&waiter.semaphore);
   lock_acquire (lock);
 }
 
+/* Like cond_wait(), but stops waiting once TICKS timer ticks have
+   passed without COND being signaled.  LOCK is reacquired before
+   returning in either case.  Returns true if COND was signaled,
+   false if the wait timed out.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+cond_wait_timeout (struct condition *cond, struct lock *lock, int64_t ticks)
+{
+  struct semaphore_elem waiter;
+  bool signaled;
+
+  ASSERT (cond != NULL);
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (lock_held_by_current_thread (lock));
+
+  sema_init (&waiter.semaphore, 0);
+  waiter.thread = thread_current ();
+  list_push_back (&cond->waiters, &waiter.elem);
+  lock_release (lock);
+  signaled = sema_down_timeout (&waiter.semaphore, ticks);
+  lock_acquire (lock);
+
+  /* A signal may have come in between the timeout and getting
+     LOCK back.  cond_signal() takes the waiter off the list and
+     ups its semaphore while holding LOCK, so either happened
+     both or neither. */
+  if (!signaled)
+    {
+      if (waiter.semaphore.value > 0)
+        signaled = true;
+      else
+        list_remove (&waiter.elem);
+    }
+  return signaled;
+}
+
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
+   this function signals the one with the highest priority to
+   wake up from its wait.
    LOCK must be held before calling this function.
 
    An interrupt handler cannot acquire a lock, so it does not
@@ -317,8 +636,26 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock_held_by_current_thread (lock));
 
   if (!list_empty (&cond->waiters))
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    {
+      struct list_elem *e = list_max (&cond->waiters,
+                                      semaphore_elem_less, NULL);
+      list_remove (e);
+      sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
+    }
+}
+
+/* Returns true if the thread waiting on semaphore_elem A has a
+   lower priority than the one waiting on semaphore_elem B. */
+static bool
+semaphore_elem_less (const struct list_elem *a_,
+                     const struct list_elem *b_, void *aux UNUSED)
+{
+  const struct semaphore_elem *a
+    = list_entry (a_, struct semaphore_elem, elem);
+  const struct semaphore_elem *b
+    = list_entry (b_, struct semaphore_elem, elem);
+
+  return a->thread->priority < b->thread->priority;
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -336,3 +673,149 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+static void rwlock_admit_readers (struct rwlock *);
+
+/* Initializes RW.  A reader-writer lock can be held either by
+   any number of readers at once or by a single writer.
+
+   Readers and writers wait on separate condition variables, and
+   the lock never wakes a thread that cannot enter right away: a
+   single writer is woken when the lock becomes free, and all
+   waiting readers are woken together when they may all enter.
+
+   A reader that arrives while a writer holds the lock or waits
+   for it has to wait, so that readers cannot starve writers.
+   POLICY decides what happens when a writer releases the lock
+   while both readers and writers wait.  With
+   RWLOCK_PREFER_WRITER the next writer goes first, which may
+   starve readers under a steady stream of writes.  With
+   RWLOCK_PHASE_FAIR all readers waiting at that moment enter
+   first, and the next writer goes after them, so reads and
+   writes alternate in phases. */
+void
+rwlock_init (struct rwlock *rw, enum rwlock_policy policy)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->read_cond);
+  cond_init (&rw->write_cond);
+  rw->policy = policy;
+  rw->readers = 0;
+  rw->writer = false;
+  rw->waiting_readers = 0;
+  rw->waiting_writers = 0;
+  rw->admitted_readers = 0;
+  rw->read_phase = 0;
+}
+
+/* Acquires RW for reading, sleeping until no writer holds it or
+   waits for it, or until this reader is admitted by a phase
+   change. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  if (rw->writer || rw->waiting_writers > 0)
+    {
+      unsigned phase = rw->read_phase;
+
+      rw->waiting_readers++;
+      while (phase == rw->read_phase
+             && (rw->writer || rw->waiting_writers > 0))
+        cond_wait (&rw->read_cond, &rw->lock);
+      rw->waiting_readers--;
+      if (phase != rw->read_phase)
+        rw->admitted_readers--;
+    }
+  rw->readers++;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   The last reader to leave wakes one waiting writer. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && rw->admitted_readers == 0)
+    {
+      if (rw->waiting_writers > 0)
+        cond_signal (&rw->write_cond, &rw->lock);
+      else if (rw->waiting_readers > 0)
+        cond_broadcast (&rw->read_cond, &rw->lock);
+    }
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it and no admitted reader is about to enter. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  rw->waiting_writers++;
+  while (rw->writer || rw->readers > 0 || rw->admitted_readers > 0)
+    cond_wait (&rw->write_cond, &rw->lock);
+  rw->waiting_writers--;
+  rw->writer = true;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for writing,
+   and wakes up the next writer or the waiting readers according
+   to RW's policy. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->writer);
+  rw->writer = false;
+  if (rw->waiting_readers > 0
+      && (rw->policy == RWLOCK_PHASE_FAIR || rw->waiting_writers == 0))
+    rwlock_admit_readers (rw);
+  else if (rw->waiting_writers > 0)
+    cond_signal (&rw->write_cond, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Atomically turns the current thread's write hold on RW into a
+   read hold, so that no writer can get in between.  Waiting
+   readers are let in along with us if RW's policy allows it. */
+void
+rwlock_downgrade (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->writer);
+  rw->writer = false;
+  rw->readers++;
+  if (rw->waiting_readers > 0
+      && (rw->policy == RWLOCK_PHASE_FAIR || rw->waiting_writers == 0))
+    rwlock_admit_readers (rw);
+  lock_release (&rw->lock);
+}
+
+/* Lets every reader currently waiting on RW enter, even if
+   writers are waiting too.  Writers stay out until all of the
+   admitted readers have entered.  RW's lock must be held. */
+static void
+rwlock_admit_readers (struct rwlock *rw)
+{
+  ASSERT (lock_held_by_current_thread (&rw->lock));
+
+  rw->admitted_readers = rw->waiting_readers;
+  rw->read_phase++;
+  cond_broadcast (&rw->read_cond, &rw->lock);
+}
@@ -2,7 +2,9 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <lockstat.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore
@@ -13,6 +15,7 @@ struct semaphore
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
+bool sema_down_timeout (struct semaphore *, int64_t ticks);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
@@ -20,15 +23,28 @@ void sema_self_test (void);
 /* Lock. */
 struct lock
   {
-    struct thread *holder;      /* Thread holding lock (for debugging). */
+    struct thread *holder;      /* Thread holding lock. */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct list_elem elem;      /* Element in holder's `locks' list. */
+
+    /* Contention profile, only kept for named locks. */
+    const char *name;           /* Name, or NULL if not profiled. */
+    long long acquire_cnt;      /* # of acquisitions. */
+    long long contended_cnt;    /* # of acquisitions that had to wait. */
+    int64_t wait_ticks;         /* Total ticks spent waiting. */
+    int64_t max_wait_ticks;     /* Longest single wait. */
+    int64_t hold_ticks;         /* Total ticks held. */
+    int64_t acquired_at;        /* Tick of the current acquisition. */
   };
 
 void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_print_stats (void);
+int lock_get_stats (struct lockstat *, int max);
 
 /* Condition variable. */
 struct condition
@@ -38,9 +54,40 @@ struct condition
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
+bool cond_wait_timeout (struct condition *, struct lock *, int64_t ticks);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Policy deciding who goes first when a writer releases a
+   reader-writer lock that both readers and writers wait for. */
+enum rwlock_policy
+  {
+    RWLOCK_PREFER_WRITER,       /* Waiting writers always go first. */
+    RWLOCK_PHASE_FAIR           /* Read and write phases alternate. */
+  };
+
+/* Reader-writer lock. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition read_cond; /* Readers waiting to enter. */
+    struct condition write_cond; /* Writers waiting to enter. */
+    enum rwlock_policy policy;  /* Who to wake when a writer leaves. */
+    int readers;                /* # of readers holding the lock. */
+    bool writer;                /* True if a writer holds the lock. */
+    int waiting_readers;        /* # of readers in read_cond. */
+    int waiting_writers;        /* # of writers in write_cond. */
+    int admitted_readers;       /* # of woken readers not yet entered. */
+    unsigned read_phase;        /* Incremented to admit waiting readers. */
+  };
+
+void rwlock_init (struct rwlock *, enum rwlock_policy);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+void rwlock_downgrade (struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -62,9 +62,9 @@ void sl_destroy(struct SynchList *sl)
 
 void sl_append(struct SynchList *sl, void *item)
 {
-  lock_acquire(&sl->sl_lock);                // enforce mutual exclusive access to the list
   struct SL_element *sl_elem = malloc(sizeof(struct SL_element));
-  sl_elem->item = item;
+  sl_elem->item = item;                      // allocate outside the lock
+  lock_acquire(&sl->sl_lock);                // enforce mutual exclusive access to the list
   list_push_back(&sl->sl_list, &sl_elem->elem);
   cond_signal(&sl->sl_empty,&sl->sl_lock);  // wake up a waiter, if any
   lock_release(&sl->sl_lock);
@@ -89,10 +89,110 @@ void *sl_remove(struct SynchList *sl)
     cond_wait(&sl->sl_empty, &sl->sl_lock);  // wait until list isn't empty
   }
   e = list_pop_front(&sl->sl_list);
+  lock_release(&sl->sl_lock);
   struct SL_element *sl_elem = list_entry(e, struct SL_element, elem);
   item = sl_elem->item;
-  free(sl_elem);
-  lock_release(&sl->sl_lock);
+  free(sl_elem);                             // free outside the lock
   return item;
 }
 
+
+//----------------------------------------------------------------------
+// SynchList::Clear
+//      Remove all elements of a list filled with sl_append_elem() or
+//	sl_append_batch().  The elements belong to the caller, so
+//	nothing is freed.
+//----------------------------------------------------------------------
+
+void sl_clear(struct SynchList *sl)
+{
+  lock_acquire(&sl->sl_lock);
+  while(!list_empty(&sl->sl_list))
+    list_pop_front(&sl->sl_list);
+  lock_release(&sl->sl_lock);
+}
+
+
+//----------------------------------------------------------------------
+// SynchList::AppendElem
+//      Append "elem", embedded in the caller's item, to the end of
+//	the list.  Unlike sl_append(), nothing is allocated.
+//----------------------------------------------------------------------
+
+void sl_append_elem(struct SynchList *sl, struct list_elem *elem)
+{
+  lock_acquire(&sl->sl_lock);
+  list_push_back(&sl->sl_list, elem);
+  cond_signal(&sl->sl_empty,&sl->sl_lock);  // wake up a waiter, if any
+  lock_release(&sl->sl_lock);
+}
+
+
+//----------------------------------------------------------------------
+// SynchList::RemoveElem
+//      Remove an element appended by sl_append_elem() or
+//	sl_append_batch() from the beginning of the list.  Wait if the
+//	list is empty.
+// Returns:
+//	The removed list_elem.
+//----------------------------------------------------------------------
+
+struct list_elem *sl_remove_elem(struct SynchList *sl)
+{
+  struct list_elem *e;
+  lock_acquire(&sl->sl_lock);
+  while(list_empty(&sl->sl_list)){
+    cond_wait(&sl->sl_empty, &sl->sl_lock);  // wait until list isn't empty
+  }
+  e = list_pop_front(&sl->sl_list);
+  lock_release(&sl->sl_lock);
+  return e;
+}
+
+
+//----------------------------------------------------------------------
+// SynchList::AppendBatch
+//      Move all elements of "batch" to the end of the list, in order,
+//	with a single lock hold, and wake up one waiter per element.
+//	"batch" is empty afterwards.
+//----------------------------------------------------------------------
+
+void sl_append_batch(struct SynchList *sl, struct list *batch)
+{
+  size_t n = list_size(batch);               // count outside the lock
+  if (n == 0)
+    return;
+  lock_acquire(&sl->sl_lock);
+  list_splice(list_end(&sl->sl_list), list_begin(batch), list_end(batch));
+  while (n-- > 0)
+    cond_signal(&sl->sl_empty,&sl->sl_lock);
+  lock_release(&sl->sl_lock);
+}
+
+
+//----------------------------------------------------------------------
+// SynchList::RemoveUpTo
+//      Move up to "n" elements from the beginning of the list to the
+//	end of "out" with a single lock hold.  Wait if the list is
+//	empty, but not for more than one element.
+// Returns:
+//	The number of elements moved, at least 1 if "n" > 0.
+//----------------------------------------------------------------------
+
+size_t sl_remove_up_to(struct SynchList *sl, struct list *out, size_t n)
+{
+  size_t moved = 0;
+  if (n == 0)
+    return 0;
+  lock_acquire(&sl->sl_lock);
+  while(list_empty(&sl->sl_list)){
+    cond_wait(&sl->sl_empty, &sl->sl_lock);  // wait until list isn't empty
+  }
+  while (moved < n && !list_empty(&sl->sl_list)) {
+    list_push_back(out, list_pop_front(&sl->sl_list));
+    moved++;
+  }
+  lock_release(&sl->sl_lock);
+  return moved;
+}
+
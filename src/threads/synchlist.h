@@ -10,6 +10,8 @@
 //
 // modified by Vlad Jahundovics for Pintos (translation from C++ to C)
 
+#ifndef THREADS_SYNCHLIST_H
+#define THREADS_SYNCHLIST_H
 
 #include "copyright.h"
 #include <list.h>
@@ -37,3 +39,16 @@ void sl_init(struct SynchList *sl);
 void sl_destroy(struct SynchList *sl);
 void sl_append(struct SynchList *sl, void *item);
 void *sl_remove(struct SynchList *sl);
+
+// Intrusive variant: the caller embeds a list_elem in each item, so
+// nothing is allocated.  A given SynchList must be used either with
+// sl_append()/sl_remove() or with the functions below, never both.
+// sl_destroy() frees what sl_append() allocated, so it only applies to
+// lists filled with sl_append(); empty intrusive lists with sl_clear().
+void sl_clear(struct SynchList *sl);
+void sl_append_elem(struct SynchList *sl, struct list_elem *elem);
+struct list_elem *sl_remove_elem(struct SynchList *sl);
+void sl_append_batch(struct SynchList *sl, struct list *batch);
+size_t sl_remove_up_to(struct SynchList *sl, struct list *out, size_t n);
+
+#endif /* threads/synchlist.h */
@@ -4,12 +4,17 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/fixed-point.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/mp.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "userprog/flist.h"
 #ifdef USERPROG
@@ -21,12 +26,31 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
-/* Idle thread. */
-static struct thread *idle_thread;
+/* Run queues of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   Each processor has its own, in its struct cpu (see cpu.h), and
+   a ready thread waits on the run queue of the processor in its
+   `cpu' member.
+
+   A thread that becomes ready goes back to the processor it ran
+   on last, unless that processor is busy and another one is
+   idle.  A processor that looks for a thread to run takes one
+   from another processor if that one has a thread of higher
+   priority than any of its own, so that the highest-priority
+   ready threads are the ones that run.
+
+   The big kernel lock (see mp.c) keeps more than one processor
+   from scheduling at a time.  That is also what makes it safe to
+   take a thread that has just put itself on a run queue from
+   another processor: the processor it ran on switches away from
+   its stack before it lets go of the lock. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+
+/* List of all processes.  Processes are added to this list
+   when they are first scheduled and removed when they exit.
+   Used by the multi-level feedback queue scheduler to update
+   every thread once per second. */
+static struct list all_list;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -47,23 +71,75 @@ static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
 
-/* Scheduling. */
-#define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
+/* Cache of pages for new threads.  thread_create() takes a page
+   from `clean_pages', which holds zeroed pages, and failing that
+   from `dirty_pages', which holds the pages of threads that have
+   died, before it falls back to palloc_get_page().
+   schedule_tail() puts the page of a dying thread on
+   `dirty_pages' instead of freeing it, as long as the cache is
+   not full.  The idle thread zeroes dirty pages and tops up
+   `clean_pages' from the page allocator, so that creating a
+   thread rarely has to scan the pool's bitmap or clear a page.
+   Both arrays are protected by turning interrupts off. */
+#define PAGE_CACHE_SIZE 16      /* Most pages kept in both arrays. */
+#define PAGE_CACHE_LOW 8        /* Idle thread refills below this. */
+static void *clean_pages[PAGE_CACHE_SIZE];
+static void *dirty_pages[PAGE_CACHE_SIZE];
+static int clean_cnt, dirty_cnt;
+
+/* Thread creation statistics. */
+static long long create_cnt;    /* # of threads created. */
+static long long clean_hits;    /* # of creations using a clean page. */
+static long long dirty_hits;    /* # of creations using a dirty page. */
+static long long cache_misses;  /* # of creations calling palloc. */
+static long long reaped_cnt;    /* # of dying threads' pages cached. */
+static long long zeroed_cnt;    /* # of dirty pages zeroed when idle. */
+static long long prefill_cnt;   /* # of pages allocated when idle. */
+
+/* Scheduling.  Each thread has its own time slice.  A thread
+   that uses up its slice has it doubled, up to thread_max_slice,
+   so CPU-bound threads are switched out less and less often.  A
+   thread that blocks has it halved, down to thread_min_slice.
+   Threads whose slice is below TIME_SLICE count as interactive:
+   when they wake up they go to the front of their run queue and
+   preempt a CPU-bound thread of the same priority. */
+#define TIME_SLICE 4            /* Initial # of timer ticks per thread. */
+unsigned thread_min_slice = 1;
+unsigned thread_max_slice = 32;
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Multi-level feedback queue scheduler. */
+#define MLFQS_PRIORITY_TICKS 4  /* # of ticks between priority updates. */
+static fixed_t load_avg;        /* System load average. */
+
 static void kernel_thread (thread_func *, void *aux);
 
-static void idle (void *aux UNUSED);
+static void idle (void *aux);
 static struct thread *running_thread (void);
-static struct thread *next_thread_to_run (void);
+static bool is_idle (const struct thread *);
+static struct cpu *select_cpu (struct thread *);
+static struct thread *next_thread_to_run (struct cpu *);
+static void ready_queue_push (struct cpu *, struct thread *);
+static void ready_queue_push_interactive (struct cpu *, struct thread *);
+static void yield_running (enum intr_level);
+static void adapt_slice (struct thread *);
+static void ready_queue_remove (struct thread *);
+static void set_effective_priority (struct thread *, int priority);
+static void mlfqs_update_priority (struct thread *, void *aux);
+static void mlfqs_update_recent_cpu (struct thread *, void *aux);
+static void mlfqs_update_load_avg (void);
+static int ready_queue_max_priority (struct cpu *);
+static struct thread *ready_queue_pop (struct cpu *, int min_priority);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
+static void *get_thread_page (void);
+static void reap_thread_page (struct thread *);
+static void refill_page_cache (void);
 static void schedule (void);
 void schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
@@ -74,7 +150,7 @@ static tid_t allocate_tid (void);
    because loader.S was careful to put the bottom of the stack at a
    page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queues and the tid lock.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -85,15 +161,29 @@ static tid_t allocate_tid (void);
 void
 thread_init (void)
 {
+  int i, j;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
-  list_init (&ready_list);
+  lock_init_named (&tid_lock, "tid");
+  for (i = 0; i < CPU_MAX; i++)
+    {
+      struct ready_queue *rq = &cpus[i].ready;
 
-  /* Set up a thread structure for the running thread. */
+      cpus[i].id = i;
+      spinlock_init (&rq->lock, "ready");
+      for (j = 0; j < PRI_CNT; j++)
+        list_init (&rq->queues[j]);
+    }
+  list_init (&all_list);
+
+  /* Set up a thread structure for the running thread, which runs
+     on the bootstrap processor. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
+  initial_thread->cpu = &cpus[0];
+  cpus[0].running = initial_thread;
   initial_thread->tid = allocate_tid ();
 
   DEBUG_thread_init();
@@ -104,6 +194,8 @@ thread_init (void)
 static void
 init_thread (struct thread *t, const char *name, int priority)
 {
+  enum intr_level old_level;
+
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
@@ -112,9 +204,30 @@ init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  t->slice = TIME_SLICE;
+  if (t->slice < thread_min_slice)
+    t->slice = thread_min_slice;
+  if (t->slice > thread_max_slice)
+    t->slice = thread_max_slice;
+  list_init (&t->locks);
+  t->cpu = running_thread ()->cpu;
   t->magic = THREAD_MAGIC;
 
+  old_level = intr_disable ();
+  list_push_back (&all_list, &t->allelem);
+
+  /* Under -mlfqs the PRIORITY argument is ignored.  A new thread
+     inherits its creator's niceness and recent CPU time, and its
+     priority is computed from those. */
+  if (thread_mlfqs && t != running_thread ())
+    {
+      t->nice = thread_current ()->nice;
+      t->recent_cpu = thread_current ()->recent_cpu;
+      mlfqs_update_priority (t, NULL);
+    }
+  intr_set_level (old_level);
+
   /* YES! You may want add stuff here. */
   flist_init(&(t->file_table));
 }
@@ -136,34 +249,177 @@ thread_start (void)
   sema_down (&idle_started);
 }
 
+/* Creates the idle thread of application processor C, which
+   mp_start() is about to start, and returns it, or a null pointer
+   if memory is exhausted.  The processor starts out running the
+   idle thread on its stack, see thread_start_ap(). */
+struct thread *
+thread_create_idle (struct cpu *c)
+{
+  struct thread *t = get_thread_page ();
+
+  if (t == NULL)
+    return NULL;
+
+  init_thread (t, "idle", PRI_MIN);
+  t->tid = allocate_tid ();
+  t->status = THREAD_RUNNING;
+  t->cpu = c;
+  c->idle_thread = c->running = t;
+  return t;
+}
+
+/* Starts scheduling on the running application processor, which
+   runs its idle thread and holds the big kernel lock. */
+void
+thread_start_ap (void)
+{
+  ASSERT (is_idle (running_thread ()));
+
+  intr_enable ();
+  idle (NULL);
+  NOT_REACHED ();
+}
+
 /* Called by the timer interrupt handler at each timer tick.
    Thus, this function runs in an external interrupt context. */
 void
 thread_tick (void)
 {
   struct thread *t = thread_current ();
+  struct cpu *c = t->cpu;
 
   /* Update statistics. */
-  if (t == idle_thread)
-    idle_ticks++;
+  if (is_idle (t))
+    {
+      idle_ticks++;
+      c->idle_ticks++;
+    }
+  else
+    {
 #ifdef USERPROG
-  else if (t->pagedir != NULL)
-    user_ticks++;
+      if (t->pagedir != NULL)
+        user_ticks++;
+      else
 #endif
-  else
-    kernel_ticks++;
+        kernel_ticks++;
+      c->busy_ticks++;
+    }
+
+  if (thread_mlfqs)
+    {
+      int64_t now = timer_ticks ();
+
+      if (!is_idle (t))
+        t->recent_cpu = fix_add_int (t->recent_cpu, 1);
+
+      /* Once per second every thread's recent_cpu decays, which
+         changes every priority.  In between, only the running
+         thread's recent_cpu changes, so it is the only priority
+         that needs recomputing.  The bootstrap processor, whose
+         ticks keep the time, does the once-a-second update for
+         all of them. */
+      if (c->id == 0 && now % TIMER_FREQ == 0)
+        {
+          mlfqs_update_load_avg ();
+          thread_foreach (mlfqs_update_recent_cpu, NULL);
+          thread_foreach (mlfqs_update_priority, NULL);
+          thread_preempt ();
+        }
+      else if ((c->idle_ticks + c->busy_ticks) % MLFQS_PRIORITY_TICKS == 0)
+        {
+          mlfqs_update_priority (t, NULL);
+          thread_preempt ();
+        }
+    }
 
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
-    intr_yield_on_return ();
+  if (++c->thread_ticks >= t->slice)
+    {
+      t->preempted = true;
+      intr_yield_on_return ();
+    }
+}
+
+/* Stores the number of voluntary and involuntary context
+   switches of the thread with identifier TID into *VOLUNTARY and
+   *INVOLUNTARY.  Returns false if there is no such thread. */
+bool
+thread_get_switches (tid_t tid, long long *voluntary,
+                     long long *involuntary)
+{
+  enum intr_level old_level = intr_disable ();
+  struct list_elem *e;
+  bool found = false;
+
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      if (t->tid == tid)
+        {
+          *voluntary = t->voluntary_switches;
+          *involuntary = t->involuntary_switches;
+          found = true;
+          break;
+        }
+    }
+  intr_set_level (old_level);
+  return found;
+}
+
+/* Invokes FUNC on every thread, passing along AUX.
+   This function must be called with interrupts off. */
+void
+thread_foreach (thread_action_func *func, void *aux)
+{
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      func (t, aux);
+    }
+}
+
+/* Accounts for TICKS timer ticks that the idle thread spent
+   halted without receiving timer interrupts.  Interrupts must be
+   off. */
+void
+thread_idle_ticks (int64_t ticks)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  idle_ticks += ticks;
+  cpus[0].idle_ticks += ticks;
 }
 
 /* Prints thread statistics. */
 void
 thread_print_stats (void)
 {
+  long long hits = clean_hits + dirty_hits;
+  int64_t seconds = timer_ticks () / TIMER_FREQ;
+  int i;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread: %lld created, %lld per second\n",
+          create_cnt, create_cnt / (seconds > 0 ? seconds : 1));
+  printf ("Thread: page cache %lld clean hits, %lld dirty hits, "
+          "%lld misses (%lld%% hit rate)\n",
+          clean_hits, dirty_hits, cache_misses,
+          create_cnt > 0 ? hits * 100 / create_cnt : 0);
+  printf ("Thread: page cache %lld reaped, %lld zeroed, %lld prefilled\n",
+          reaped_cnt, zeroed_cnt, prefill_cnt);
+  if (cpu_cnt > 1)
+    for (i = 0; i < cpu_cnt; i++)
+      printf ("Thread: CPU %d: %lld idle ticks, %lld busy ticks, "
+              "%lld stolen, %lld IPIs\n", i, cpus[i].idle_ticks,
+              cpus[i].busy_ticks, cpus[i].stolen_cnt, cpus[i].ipi_cnt);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -178,9 +434,9 @@ thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If PRIORITY is higher than the running thread's priority, the
+   new thread preempts the running thread before thread_create()
+   returns. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux)
@@ -200,7 +456,7 @@ thread_create (const char *name, int priority,
     return TID_ERROR;
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = get_thread_page ();
   if (t == NULL)
     return TID_ERROR;
 
@@ -245,6 +501,7 @@ thread_block (void)
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
+  TRACE (TRACE_BLOCK, 0, 0);
   thread_current ()->status = THREAD_BLOCKED;
   schedule ();
 }
@@ -253,22 +510,96 @@ thread_block (void)
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
 
-   This function does not preempt the running thread.  This can
-   be important: if the caller had disabled interrupts itself,
-   it may expect that it can atomically unblock a thread and
-   update other data. */
+   If T has a higher priority than the running thread, the running
+   thread is preempted, but only when that is safe: from an
+   external interrupt handler or a softirq the yield is deferred
+   until the handler returns, and if the caller had disabled interrupts
+   itself nothing happens at all.  The latter can be important:
+   such a caller may expect that it can atomically unblock a
+   thread and update other data, and should call thread_preempt()
+   once it is done. */
 void
 thread_unblock (struct thread *t)
 {
+  struct thread *cur;
+  struct cpu *c;
   enum intr_level old_level;
+  bool boost = false;
 
   ASSERT (is_thread (t));
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  TRACE (TRACE_UNBLOCK, t->tid, 0);
+  cur = running_thread ();
+  c = select_cpu (t);
+  if (t->slice < TIME_SLICE)
+    {
+      /* Latency boost for an interactive thread. */
+      ready_queue_push_interactive (c, t);
+      boost = (c == cur->cpu && !is_idle (cur)
+               && cur->priority == t->priority && cur->slice > TIME_SLICE);
+    }
+  else
+    ready_queue_push (c, t);
   t->status = THREAD_READY;
+
+  /* Wake up another processor that should run T now. */
+  if (c != cur->cpu
+      && (c->running == c->idle_thread || c->running->priority < t->priority))
+    mp_reschedule (c);
+  intr_set_level (old_level);
+
+  if (boost)
+    yield_running (old_level);
+  else
+    thread_preempt ();
+}
+
+/* Yields the CPU if a thread with a higher priority than the
+   running thread is ready to run.  In an external interrupt
+   context or a softirq the yield happens when the handler
+   returns.  Does
+   nothing if interrupts are disabled outside of an interrupt
+   handler, since the caller then expects to run atomically. */
+void
+thread_preempt (void)
+{
+  struct thread *cur;
+  struct cpu *c;
+  enum intr_level old_level;
+  int max_priority;
+  bool preempt;
+
+  old_level = intr_disable ();
+  cur = running_thread ();
+  c = cur->cpu;
+  max_priority = ready_queue_max_priority (c);
+  preempt = (c->idle_thread != NULL && max_priority >= PRI_MIN
+             && (cur == c->idle_thread || max_priority > cur->priority));
   intr_set_level (old_level);
+
+  if (preempt)
+    yield_running (old_level);
+}
+
+/* Makes the running thread give up the CPU to a thread that
+   should run instead, in the ways thread_preempt() describes.
+   OLD_LEVEL is the interrupt level the caller found. */
+static void
+yield_running (enum intr_level old_level)
+{
+  if (intr_context ())
+    {
+      running_thread ()->preempted = true;
+      intr_yield_on_return ();
+    }
+  else if (old_level == INTR_ON)
+    {
+      thread_current ()->preempted = true;
+      if (!intr_defer_yield ())
+        thread_yield ();
+    }
 }
 
 /* Returns the name of the running thread. */
@@ -319,6 +650,7 @@ thread_exit (void)
   /* Just set our status to dying and schedule another process.
      We will be destroyed during the call to schedule_tail(). */
   intr_disable ();
+  list_remove (&thread_current ()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -335,80 +667,284 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread)
-    list_push_back (&ready_list, &cur->elem);
+  if (!is_idle (cur))
+    ready_queue_push (cur->cpu, cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY.  The
+   effective priority stays raised while other threads donate a
+   higher priority to us.  Yields immediately if the running
+   thread no longer has the highest priority.
+
+   Ignored under -mlfqs, where the scheduler computes priorities
+   itself. */
 void
 thread_set_priority (int new_priority)
 {
-  thread_current ()->priority = new_priority;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  cur->base_priority = new_priority;
+  thread_update_priority (cur);
+  intr_set_level (old_level);
+
+  thread_preempt ();
+}
+
+/* Raises T's effective priority to PRIORITY, if that is higher
+   than its current one.  A ready thread is moved to the run
+   queue of its new priority.  Interrupts must be off. */
+void
+thread_donate_priority (struct thread *t, int priority)
+{
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (priority > t->priority)
+    set_effective_priority (t, priority);
+}
+
+/* Recomputes T's effective priority as the maximum of its base
+   priority and the priorities of all threads waiting for locks
+   that T holds.  A ready thread is moved to the run queue of its
+   new priority.  Interrupts must be off.
+
+   Does nothing under -mlfqs, which does not donate priority. */
+void
+thread_update_priority (struct thread *t)
+{
+  struct list_elem *e;
+  int priority;
+
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs)
+    return;
+
+  priority = t->base_priority;
+  for (e = list_begin (&t->locks); e != list_end (&t->locks);
+       e = list_next (e))
+    {
+      struct list *waiters = &list_entry (e, struct lock, elem)
+                               ->semaphore.waiters;
+      if (!list_empty (waiters))
+        {
+          struct thread *donor
+            = list_entry (list_max (waiters, thread_priority_less, NULL),
+                          struct thread, elem);
+          if (donor->priority > priority)
+            priority = donor->priority;
+        }
+    }
+
+  if (priority != t->priority)
+    set_effective_priority (t, priority);
+}
+
+/* Sets T's effective priority to PRIORITY, moving T to the
+   matching run queue if it is ready.  Interrupts must be off. */
+static void
+set_effective_priority (struct thread *t, int priority)
+{
+  if (t->status == THREAD_READY)
+    {
+      ready_queue_remove (t);
+      t->priority = priority;
+      ready_queue_push (t->cpu, t);
+    }
+  else
+    t->priority = priority;
+}
+
+/* Returns true if the thread owning `elem' A has a lower
+   effective priority than the thread owning `elem' B. */
+bool
+thread_priority_less (const struct list_elem *a_,
+                      const struct list_elem *b_, void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->priority < b->priority;
 }
 
-/* Returns the current thread's priority. */
+/* Returns the current thread's effective priority. */
 int
 thread_get_priority (void)
 {
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest
+   priority. */
 void
-thread_set_nice (int nice UNUSED)
+thread_set_nice (int nice)
 {
-  /* Not yet implemented. */
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  thread_current ()->nice = nice;
+  if (thread_mlfqs)
+    mlfqs_update_priority (thread_current (), NULL);
+  intr_set_level (old_level);
+
+  thread_preempt ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load_avg_100 = fix_round (fix_mul_int (load_avg, 100));
+  intr_set_level (old_level);
+
+  return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu_100
+    = fix_round (fix_mul_int (thread_current ()->recent_cpu, 100));
+  intr_set_level (old_level);
+
+  return recent_cpu_100;
+}
+
+/* Recomputes T's priority for the multi-level feedback queue
+   scheduler as
+       priority = PRI_MAX - (recent_cpu / 4) - (nice * 2),
+   clamped to the valid range.  Interrupts must be off. */
+static void
+mlfqs_update_priority (struct thread *t, void *aux UNUSED)
+{
+  int priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (is_idle (t))
+    return;
+
+  priority = PRI_MAX - fix_trunc (fix_div_int (t->recent_cpu, 4))
+             - t->nice * 2;
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+
+  t->base_priority = priority;
+  if (priority != t->priority)
+    set_effective_priority (t, priority);
+}
+
+/* Decays T's recent_cpu as
+       recent_cpu = (2*load_avg)/(2*load_avg + 1) * recent_cpu + nice.
+   Interrupts must be off. */
+static void
+mlfqs_update_recent_cpu (struct thread *t, void *aux UNUSED)
+{
+  fixed_t twice_load = fix_mul_int (load_avg, 2);
+  fixed_t coefficient = fix_div (twice_load, fix_add_int (twice_load, 1));
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (is_idle (t))
+    return;
+
+  t->recent_cpu = fix_add_int (fix_mul (coefficient, t->recent_cpu),
+                               t->nice);
+}
+
+/* Updates the system load average as
+       load_avg = (59/60)*load_avg + (1/60)*ready_threads,
+   where ready_threads counts the threads running on every
+   processor, except idle threads, and every thread in the run
+   queues.  Interrupts must be off. */
+static void
+mlfqs_update_load_avg (void)
+{
+  int ready_threads = 0;
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      ready_threads += cpus[i].ready.cnt;
+      if (!is_idle (cpus[i].running))
+        ready_threads++;
+    }
+  load_avg = fix_add (fix_div_int (fix_mul_int (load_avg, 59), 60),
+                      fix_div_int (fix_int (ready_threads), 60));
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
 
-   The idle thread is initially put on the ready list by
-   thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   The bootstrap processor's idle thread is initially put on the
+   ready list by thread_start().  It will be scheduled once
+   initially, at which point it initializes its processor's
+   idle_thread, "up"s the semaphore passed to it to enable
+   thread_start() to continue, and immediately blocks.  After
+   that, the idle thread never appears in the ready list.  It is
+   returned by next_thread_to_run() as a special case when the
+   ready list is empty.  An application processor starts out in
+   its idle thread, which thread_start_ap() calls with a null
+   IDLE_STARTED_. */
 static void
-idle (void *idle_started_ UNUSED)
+idle (void *idle_started_)
 {
   struct semaphore *idle_started = idle_started_;
-  idle_thread = thread_current ();
-  sema_up (idle_started);
+
+  if (idle_started != NULL)
+    {
+      running_thread ()->cpu->idle_thread = thread_current ();
+      sema_up (idle_started);
+    }
 
   for (;;)
     {
+      /* Prepare pages for new threads while nothing else runs. */
+      refill_page_cache ();
+
       /* Let someone else run. */
       intr_disable ();
       thread_block ();
 
+      /* Nothing else can run.  Stop the periodic tick until the
+         next deadline, if tickless idle is enabled.  Only a lone
+         processor does: with several, the others may need the
+         tick for deadlines this one does not know about yet. */
+      if (cpu_cnt == 1)
+        timer_idle_enter ();
+
+      /* Let other processors into the kernel while this one
+         halts.  The interrupt that wakes it takes the lock
+         back. */
+      mp_leave_kernel ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -470,18 +1006,206 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
-/* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
-static struct thread *
-next_thread_to_run (void)
+/* Returns true if T is the idle thread of the processor it runs
+   on. */
+static bool
+is_idle (const struct thread *t)
+{
+  return t->cpu != NULL && t == t->cpu->idle_thread;
+}
+
+/* Returns true if processor C has nothing to do. */
+static bool
+cpu_is_idle (const struct cpu *c)
+{
+  return c->running == c->idle_thread && c->ready.cnt == 0;
+}
+
+/* Returns the processor on whose run queue T should wait to run:
+   the one it last ran on, unless that one is busy and another
+   one is idle.  Interrupts must be off. */
+static struct cpu *
+select_cpu (struct thread *t)
+{
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (cpu_is_idle (t->cpu))
+    return t->cpu;
+  for (i = 0; i < cpu_cnt; i++)
+    if (cpu_is_idle (&cpus[i]))
+      return &cpus[i];
+  return t->cpu;
+}
+
+/* Adds T to the back of processor C's run queue for its
+   priority.  Interrupts must be off. */
+static void
+ready_queue_push (struct cpu *c, struct thread *t)
+{
+  struct ready_queue *rq = &c->ready;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  spinlock_acquire (&rq->lock);
+  t->cpu = c;
+  list_push_back (&rq->queues[t->priority - PRI_MIN], &t->elem);
+  rq->mask |= (uint64_t) 1 << (t->priority - PRI_MIN);
+  rq->cnt++;
+  spinlock_release (&rq->lock);
+}
+
+/* Adds interactive thread T to processor C's run queue for its
+   priority ahead of every CPU-bound thread, but behind the
+   interactive threads already there, so they still run first
+   come, first served.  Interrupts must be off. */
+static void
+ready_queue_push_interactive (struct cpu *c, struct thread *t)
+{
+  struct ready_queue *rq = &c->ready;
+  struct list *queue = &rq->queues[t->priority - PRI_MIN];
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  spinlock_acquire (&rq->lock);
+  t->cpu = c;
+  for (e = list_begin (queue); e != list_end (queue); e = list_next (e))
+    if (list_entry (e, struct thread, elem)->slice >= TIME_SLICE)
+      break;
+  list_insert (e, &t->elem);
+  rq->mask |= (uint64_t) 1 << (t->priority - PRI_MIN);
+  rq->cnt++;
+  spinlock_release (&rq->lock);
+}
+
+/* Removes ready thread T from its processor's run queue.
+   Interrupts must be off. */
+static void
+ready_queue_remove (struct thread *t)
 {
-  if (list_empty (&ready_list))
-    return idle_thread;
+  struct ready_queue *rq = &t->cpu->ready;
+  struct list *queue = &rq->queues[t->priority - PRI_MIN];
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  spinlock_acquire (&rq->lock);
+  list_remove (&t->elem);
+  if (list_empty (queue))
+    rq->mask &= ~((uint64_t) 1 << (t->priority - PRI_MIN));
+  rq->cnt--;
+  spinlock_release (&rq->lock);
+}
+
+/* Returns the highest priority whose bit is set in MASK, or
+   PRI_MIN - 1 if none is.
+
+   The occupancy bitmap is examined one 32-bit half at a time so
+   that __builtin_clz() compiles to a single BSR instruction
+   instead of a call into libgcc. */
+static int
+mask_max_priority (uint64_t mask)
+{
+  uint32_t hi = mask >> 32;
+  uint32_t lo = mask;
+
+  if (hi != 0)
+    return PRI_MIN + 63 - __builtin_clz (hi);
+  else if (lo != 0)
+    return PRI_MIN + 31 - __builtin_clz (lo);
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    return PRI_MIN - 1;
+}
+
+/* Returns the priority of the highest-priority thread ready on
+   processor C, or PRI_MIN - 1 if no thread is ready there.
+   Interrupts must be off. */
+static int
+ready_queue_max_priority (struct cpu *c)
+{
+  struct ready_queue *rq = &c->ready;
+  int priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  spinlock_acquire (&rq->lock);
+  priority = mask_max_priority (rq->mask);
+  spinlock_release (&rq->lock);
+  return priority;
+}
+
+/* Removes and returns the thread at the front of processor C's
+   highest-priority non-empty run queue, if its priority is at
+   least MIN_PRIORITY, or returns a null pointer otherwise.
+   Interrupts must be off. */
+static struct thread *
+ready_queue_pop (struct cpu *c, int min_priority)
+{
+  struct ready_queue *rq = &c->ready;
+  struct thread *next = NULL;
+  int priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  spinlock_acquire (&rq->lock);
+  priority = mask_max_priority (rq->mask);
+  if (priority >= min_priority && priority >= PRI_MIN)
+    {
+      struct list *queue = &rq->queues[priority - PRI_MIN];
+
+      next = list_entry (list_pop_front (queue), struct thread, elem);
+      if (list_empty (queue))
+        rq->mask &= ~((uint64_t) 1 << (priority - PRI_MIN));
+      rq->cnt--;
+    }
+  spinlock_release (&rq->lock);
+  return next;
+}
+
+/* Chooses and returns the next thread to be scheduled on
+   processor C.  Should return a thread from a run queue, unless
+   the run queues are empty.  (If the running thread can continue
+   running, then it will be in C's run queue.)  If the run queues
+   are empty, return C's idle thread.
+
+   The thread returned is the one at the front of the
+   highest-priority non-empty run queue, so threads of equal
+   priority are scheduled round-robin.  It comes from another
+   processor's run queue only if that queue has a thread of
+   higher priority than any in C's. */
+static struct thread *
+next_thread_to_run (struct cpu *c)
+{
+  int priority = ready_queue_max_priority (c);
+  struct cpu *busiest = NULL;
+  struct thread *next;
+  int i;
+
+  for (i = 0; i < cpu_cnt; i++)
+    if (&cpus[i] != c)
+      {
+        int other = ready_queue_max_priority (&cpus[i]);
+        if (other > priority)
+          {
+            priority = other;
+            busiest = &cpus[i];
+          }
+      }
+
+  if (busiest != NULL)
+    {
+      next = ready_queue_pop (busiest, priority);
+      next->cpu = c;
+      c->stolen_cnt++;
+      return next;
+    }
+
+  next = ready_queue_pop (c, PRI_MIN);
+  return next != NULL ? next : c->idle_thread;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -511,7 +1235,7 @@ schedule_tail (struct thread *prev)
   cur->status = THREAD_RUNNING;
 
   /* Start new time slice. */
-  thread_ticks = 0;
+  cur->cpu->thread_ticks = 0;
 
 #ifdef USERPROG
   /* Activate the new address space. */
@@ -526,7 +1250,7 @@ schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      reap_thread_page (prev);
     }
 }
 
@@ -541,18 +1265,161 @@ static void
 schedule (void)
 {
   struct thread *cur = running_thread ();
-  struct thread *next = next_thread_to_run ();
+  struct cpu *c = cur->cpu;
+  struct thread *next;
   struct thread *prev = NULL;
 
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT (cur->status != THREAD_RUNNING);
+
+  /* If the periodic tick was stopped while the idle thread was
+     halted, restart it and catch up before anything else runs.
+     This may wake up sleeping threads, so do it before choosing
+     the next thread. */
+  if (cur == c->idle_thread)
+    timer_idle_exit ();
+  else
+    adapt_slice (cur);
+
+  next = next_thread_to_run (c);
   ASSERT (is_thread (next));
+  c->running = next;
 
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      TRACE (TRACE_SCHEDULE, cur->tid, next->tid);
+      prev = switch_threads (cur, next);
+    }
   schedule_tail (prev);
 }
 
+/* Returns a zeroed page for a new thread, or a null pointer if
+   memory is exhausted.  Uses the page cache if possible. */
+static void *
+get_thread_page (void)
+{
+  enum intr_level old_level = intr_disable ();
+  void *page = NULL;
+
+  create_cnt++;
+  if (clean_cnt > 0)
+    {
+      page = clean_pages[--clean_cnt];
+      clean_hits++;
+      intr_set_level (old_level);
+    }
+  else if (dirty_cnt > 0)
+    {
+      page = dirty_pages[--dirty_cnt];
+      dirty_hits++;
+      intr_set_level (old_level);
+      memset (page, 0, PGSIZE);
+    }
+  else
+    {
+      cache_misses++;
+      intr_set_level (old_level);
+      page = palloc_get_page (PAL_ZERO);
+    }
+  return page;
+}
+
+/* Disposes of the page of dying thread T.  Keeps it in the page
+   cache unless the cache is full.  Interrupts must be off. */
+static void
+reap_thread_page (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (clean_cnt + dirty_cnt < PAGE_CACHE_SIZE)
+    {
+      dirty_pages[dirty_cnt++] = t;
+      reaped_cnt++;
+    }
+  else
+    palloc_free_page (t);
+}
+
+/* Called by the idle thread, with interrupts on.  Zeroes the
+   dirty pages in the page cache, then tops up the clean pages
+   from the page allocator.  The idle thread must never block, so
+   it only allocates if the kernel pool is not in use, and it
+   holds the pool with interrupts off so that no other thread can
+   find it busy and wait for the idle thread. */
+static void
+refill_page_cache (void)
+{
+  enum intr_level old_level;
+  void *page;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  for (;;)
+    {
+      old_level = intr_disable ();
+      if (dirty_cnt == 0)
+        break;
+      page = dirty_pages[--dirty_cnt];
+      intr_set_level (old_level);
+
+      memset (page, 0, PGSIZE);
+
+      intr_disable ();
+      clean_pages[clean_cnt++] = page;
+      zeroed_cnt++;
+      intr_set_level (old_level);
+    }
+
+  while (clean_cnt + dirty_cnt < PAGE_CACHE_LOW)
+    {
+      page = palloc_get_page (PAL_NOWAIT);
+      intr_set_level (old_level);
+      if (page == NULL)
+        return;
+
+      memset (page, 0, PGSIZE);
+
+      intr_disable ();
+      if (clean_cnt + dirty_cnt < PAGE_CACHE_SIZE)
+        {
+          clean_pages[clean_cnt++] = page;
+          prefill_cnt++;
+        }
+      else
+        palloc_free_page (page);
+    }
+  intr_set_level (old_level);
+}
+
+/* Counts the context switch of CUR, which is leaving the CPU,
+   and adjusts its time slice.  Interrupts must be off. */
+static void
+adapt_slice (struct thread *cur)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (cur->status == THREAD_BLOCKED)
+    {
+      cur->voluntary_switches++;
+      cur->slice /= 2;
+      if (cur->slice < thread_min_slice)
+        cur->slice = thread_min_slice;
+    }
+  else if (cur->status == THREAD_READY && cur->preempted)
+    {
+      cur->involuntary_switches++;
+      if (cur->cpu->thread_ticks >= cur->slice)
+        {
+          cur->slice *= 2;
+          if (cur->slice > thread_max_slice)
+            cur->slice = thread_max_slice;
+        }
+    }
+  else if (cur->status == THREAD_READY)
+    cur->voluntary_switches++;
+  cur->preempted = false;
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void)
@@ -567,6 +1434,15 @@ allocate_tid (void)
   return tid;
 }
 
+/* Returns the processor that runs the running thread.  Unless
+   interrupts are off, the thread may move to another processor
+   right after. */
+struct cpu *
+cpu_current (void)
+{
+  return running_thread ()->cpu;
+}
+
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof (struct thread, stack);
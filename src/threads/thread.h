@@ -5,6 +5,7 @@
 #include <list.h>
 #include <stdint.h>
 
+#include "threads/fixed-point.h"
 #include "userprog/flist.h"
 
 /* States in a thread's life cycle. */
@@ -26,6 +27,12 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, used by the multi-level feedback queue
+   scheduler. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -89,10 +96,27 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Effective priority. */
+    int base_priority;                  /* Priority before donation. */
+    int nice;                           /* Niceness, for -mlfqs. */
+    fixed_t recent_cpu;                 /* Recent CPU time, for -mlfqs. */
+    unsigned slice;                     /* Time slice, in timer ticks. */
+    bool preempted;                     /* Being switched out involuntarily. */
+    long long voluntary_switches;       /* # of times it blocked or yielded. */
+    long long involuntary_switches;     /* # of times it was preempted. */
+    struct cpu *cpu;                    /* Processor it runs or waits on. */
+    struct list_elem allelem;           /* Element in list of all threads. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct list locks;                  /* Locks held, for donation. */
+    struct lock *waiting_lock;          /* Lock being waited for, or NULL. */
+
+    /* Owned by devices/timer.c. */
+    int64_t wakeup_tick;                /* Tick to wake up at when sleeping. */
+    struct list_elem sleep_elem;        /* Element in timer's sleep list. */
+    bool timed_wait;                    /* `elem' is on a timed wait queue. */
+    int64_t wakeup_ns;                  /* Deadline of a sub-tick sleep. */
 
     /* YES! You may want to add stuff. But make note of point 2 above. */
     struct flist file_table;             /* File table. */
@@ -100,6 +124,9 @@ struct thread
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+
+    /* Owned by userprog/ring.c. */
+    struct ring_ctx *ring;              /* Batched syscall rings, or NULL. */
 #endif
 
     /* Owned by thread.c. */
@@ -111,17 +138,34 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* Bounds for adaptive time slices, in timer ticks.  Controlled
+   by kernel command-line options "-min-slice" and "-max-slice". */
+extern unsigned thread_min_slice;
+extern unsigned thread_max_slice;
+
+struct cpu;
+
 void thread_init (void);
 void thread_start (void);
+struct thread *thread_create_idle (struct cpu *);
+void thread_start_ap (void) NO_RETURN;
 
 void thread_tick (void);
+void thread_idle_ticks (int64_t);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
+/* Performs some operation on thread t, given auxiliary data AUX. */
+typedef void thread_action_func (struct thread *t, void *aux);
+void thread_foreach (thread_action_func *, void *);
+bool thread_get_switches (tid_t, long long *voluntary,
+                          long long *involuntary);
+
 void thread_block (void);
 void thread_unblock (struct thread *);
+void thread_preempt (void);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -132,6 +176,10 @@ void thread_yield (void);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_donate_priority (struct thread *, int priority);
+void thread_update_priority (struct thread *);
+bool thread_priority_less (const struct list_elem *,
+                           const struct list_elem *, void *aux);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
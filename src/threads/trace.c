@@ -0,0 +1,102 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/serial.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Size of the ring buffer, in pages. */
+#define TRACE_PAGES 32
+
+bool trace_enabled;
+
+static struct trace_record *ring;       /* Ring buffer, or null. */
+static size_t ring_size;                /* Number of records in ring. */
+static uint64_t written;                /* Total records written. */
+
+
+/* Returns the tid of the running thread.  Unlike
+   thread_current(), this works inside schedule(), where the
+   running thread is no longer in the THREAD_RUNNING state. */
+static inline tid_t
+running_tid (void)
+{
+  uint32_t *esp;
+
+  asm ("mov %%esp, %0" : "=g" (esp));
+  return ((struct thread *) pg_round_down (esp))->tid;
+}
+
+/* Allocates the ring buffer if tracing was requested.  Must be
+   called after palloc_init().  Tracepoints hit before that, or
+   if memory runs out, are not recorded. */
+void
+trace_init (void)
+{
+  if (!trace_enabled)
+    return;
+
+  ring = palloc_get_multiple (0, TRACE_PAGES);
+  if (ring == NULL)
+    {
+      printf ("trace: out of memory, tracing disabled\n");
+      trace_enabled = false;
+      return;
+    }
+  ring_size = TRACE_PAGES * PGSIZE / sizeof *ring;
+}
+
+/* Records EVENT with arguments ARG0 and ARG1.  Use TRACE()
+   instead, which skips the call when tracing is off.  May be
+   called from an interrupt handler. */
+void
+trace_event (enum trace_event event, uint32_t arg0, uint32_t arg1)
+{
+  enum intr_level old_level;
+  struct trace_record *r;
+
+  if (ring == NULL)
+    return;
+
+  old_level = intr_disable ();
+  r = &ring[written++ % ring_size];
+  r->tsc = rdtsc ();
+  r->tid = running_tid ();
+  r->event = event;
+  r->arg0 = arg0;
+  r->arg1 = arg1;
+  intr_set_level (old_level);
+}
+
+/* Stops tracing and writes the records in the ring, oldest first,
+   to the serial port as hex, between "TRACE-BEGIN" and
+   "TRACE-END" lines.  The console is bypassed because it would
+   itself hit tracepoints. */
+void
+trace_dump (void)
+{
+  uint64_t first, i;
+  char line[80];
+
+  if (ring == NULL)
+    return;
+  trace_enabled = false;
+
+  first = written > ring_size ? written - ring_size : 0;
+
+  snprintf (line, sizeof line, "TRACE-BEGIN %llu %llu %llu\n",
+            written - first, written, timer_tsc_hz ());
+  serial_puts (line);
+  for (i = first; i < written; i++)
+    {
+      const struct trace_record *r = &ring[i % ring_size];
+      snprintf (line, sizeof line, "%016llx %d %u %08x %08x\n",
+                r->tsc, r->tid, r->event, r->arg0, r->arg1);
+      serial_puts (line);
+    }
+  serial_puts ("TRACE-END\n");
+}
@@ -0,0 +1,57 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Static kernel tracepoints.
+
+   With the "-trace" kernel option, each TRACE() writes a
+   fixed-size binary record into a ring buffer that holds the most
+   recent records of this boot.  The ring is dumped to the serial
+   port at power-off, where utils/pintos-trace turns it into
+   Chrome trace JSON.  Without the option, a tracepoint costs one
+   test of trace_enabled. */
+
+/* Event ids.  utils/pintos-trace knows these by number, so only
+   ever add new ones at the end. */
+enum trace_event
+  {
+    TRACE_SCHEDULE,             /* Context switch: prev tid, next tid. */
+    TRACE_BLOCK,                /* Current thread blocks. */
+    TRACE_UNBLOCK,              /* Thread is unblocked: tid. */
+    TRACE_LOCK_WAIT,            /* Starts acquiring lock: lock, holder tid. */
+    TRACE_LOCK_ACQUIRED,        /* Got the lock: lock. */
+    TRACE_LOCK_RELEASE,         /* Releases the lock: lock. */
+    TRACE_DISK_READ,            /* Starts disk read: sector, disk. */
+    TRACE_DISK_WRITE,           /* Starts disk write: sector, disk. */
+    TRACE_DISK_DONE,            /* Disk read or write done: sector. */
+    TRACE_SYSCALL_ENTER,        /* System call entry: number. */
+    TRACE_SYSCALL_EXIT,         /* System call exit: number, result. */
+    TRACE_PAGE_FAULT            /* Page fault: address, eip. */
+  };
+
+/* One trace record.  Its layout is known to utils/pintos-trace. */
+struct trace_record
+  {
+    uint64_t tsc;               /* Time stamp counter. */
+    int32_t tid;                /* Thread running at the time. */
+    uint32_t event;             /* enum trace_event. */
+    uint32_t arg0;              /* Event specific. */
+    uint32_t arg1;              /* Event specific. */
+  };
+
+/* Set by kernel command-line option "-trace". */
+extern bool trace_enabled;
+
+#define TRACE(EVENT, ARG0, ARG1)                                        \
+        do {                                                            \
+          if (trace_enabled)                                            \
+            trace_event (EVENT, (uint32_t) (ARG0), (uint32_t) (ARG1));  \
+        } while (0)
+
+void trace_init (void);
+void trace_event (enum trace_event, uint32_t arg0, uint32_t arg1);
+void trace_dump (void);
+
+#endif /* threads/trace.h */
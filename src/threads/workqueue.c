@@ -0,0 +1,151 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* A queued call to FUNC (AUX). */
+struct work
+  {
+    struct list_elem elem;      /* Element in workqueue's `active'. */
+    work_func *func;            /* Function to call. */
+    void *aux;                  /* Argument to FUNC. */
+    int64_t seq;                /* Order in which the work was queued. */
+    int64_t queued_at;          /* Timer tick at which it was queued. */
+  };
+
+struct workqueue system_wq;
+
+static thread_func worker;
+
+/* Initializes WQ and starts THREAD_CNT worker threads for it,
+   named after NAME.  Must be called after thread_start(). */
+void
+workqueue_init (struct workqueue *wq, const char *name, int thread_cnt)
+{
+  int i;
+
+  ASSERT (wq != NULL);
+  ASSERT (thread_cnt > 0);
+
+  wq->name = name;
+  sl_init (&wq->pending);
+  lock_init (&wq->lock);
+  cond_init (&wq->progress);
+  list_init (&wq->active);
+  wq->next_seq = 0;
+  wq->queued_cnt = wq->done_cnt = 0;
+  wq->wait_ticks = wq->run_ticks = 0;
+  wq->depth = wq->max_depth = 0;
+
+  wq->thread_cnt = 0;
+  for (i = 0; i < thread_cnt; i++)
+    {
+      char thread_name[16];
+
+      snprintf (thread_name, sizeof thread_name, "%s/%d", name, i);
+      if (thread_create (thread_name, PRI_DEFAULT, worker, wq) != TID_ERROR)
+        wq->thread_cnt++;
+    }
+  if (wq->thread_cnt == 0)
+    PANIC ("%s: could not start any worker thread", name);
+}
+
+/* Arranges for FUNC (AUX) to be called by one of WQ's worker
+   threads, and returns without waiting for it.  Work is started
+   in the order it was queued, but with more than one worker
+   several items may run at the same time.  If memory runs out,
+   FUNC is called right away instead.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+queue_work (struct workqueue *wq, work_func *func, void *aux)
+{
+  struct work *w;
+
+  ASSERT (wq != NULL);
+  ASSERT (func != NULL);
+  ASSERT (!intr_context ());
+
+  w = malloc (sizeof *w);
+  if (w == NULL)
+    {
+      func (aux);
+      return;
+    }
+  w->func = func;
+  w->aux = aux;
+  w->queued_at = timer_ticks ();
+
+  lock_acquire (&wq->lock);
+  w->seq = wq->next_seq++;
+  list_push_back (&wq->active, &w->elem);
+  wq->queued_cnt++;
+  if (++wq->depth > wq->max_depth)
+    wq->max_depth = wq->depth;
+  lock_release (&wq->lock);
+
+  sl_append (&wq->pending, w);
+}
+
+/* Waits until all work queued on WQ before this call has
+   completed.  Work queued afterward is not waited for, so this
+   returns even if WQ never becomes idle.  Must not be called by
+   WQ's own work functions, which would wait for themselves. */
+void
+flush_work (struct workqueue *wq)
+{
+  int64_t target;
+
+  ASSERT (wq != NULL);
+
+  lock_acquire (&wq->lock);
+  target = wq->next_seq;
+  while (!list_empty (&wq->active)
+         && list_entry (list_front (&wq->active),
+                        struct work, elem)->seq < target)
+    cond_wait (&wq->progress, &wq->lock);
+  lock_release (&wq->lock);
+}
+
+/* Prints statistics for WQ. */
+void
+workqueue_print_stats (struct workqueue *wq)
+{
+  lock_acquire (&wq->lock);
+  printf ("Workqueue %s: %lld queued, %lld done, max depth %d, "
+          "%lld wait ticks, %lld run ticks\n",
+          wq->name, wq->queued_cnt, wq->done_cnt, wq->max_depth,
+          wq->wait_ticks, wq->run_ticks);
+  lock_release (&wq->lock);
+}
+
+/* Worker thread body: runs work from the workqueue passed as
+   WQ_ forever. */
+static void
+worker (void *wq_)
+{
+  struct workqueue *wq = wq_;
+
+  for (;;)
+    {
+      struct work *w = sl_remove (&wq->pending);
+      int64_t start = timer_ticks ();
+
+      w->func (w->aux);
+
+      lock_acquire (&wq->lock);
+      wq->wait_ticks += start - w->queued_at;
+      wq->run_ticks += timer_elapsed (start);
+      wq->done_cnt++;
+      wq->depth--;
+      list_remove (&w->elem);
+      cond_broadcast (&wq->progress, &wq->lock);
+      lock_release (&wq->lock);
+
+      free (w);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdint.h>
+#include "threads/synch.h"
+#include "threads/synchlist.h"
+
+/* A function run by a workqueue's worker thread. */
+typedef void work_func (void *aux);
+
+/* A workqueue: a small pool of kernel threads that run deferred
+   work in the order it was queued. */
+struct workqueue
+  {
+    const char *name;           /* Name, for statistics. */
+    struct SynchList pending;   /* Work not yet picked up by a worker. */
+    int thread_cnt;             /* Number of worker threads. */
+
+    struct lock lock;           /* Protects the members below. */
+    struct condition progress;  /* Signaled whenever work completes. */
+    struct list active;         /* Pending and running work, oldest first. */
+    int64_t next_seq;           /* Sequence number of the next work. */
+
+    /* Statistics. */
+    long long queued_cnt;       /* # of work items queued. */
+    long long done_cnt;         /* # of work items completed. */
+    long long wait_ticks;       /* Total ticks spent waiting to start. */
+    long long run_ticks;        /* Total ticks spent running. */
+    int depth;                  /* # of items in `active' now. */
+    int max_depth;              /* Largest `depth' so far. */
+  };
+
+/* Shared workqueue for deferred kernel work. */
+extern struct workqueue system_wq;
+
+void workqueue_init (struct workqueue *, const char *name, int thread_cnt);
+void queue_work (struct workqueue *, work_func *, void *aux);
+void flush_work (struct workqueue *);
+void workqueue_print_stats (struct workqueue *);
+
+#endif /* threads/workqueue.h */
@@ -2,12 +2,18 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/vaddr.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+/* Number of those recovered from through the exception table. */
+static long long fixup_cnt;
+
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
@@ -64,7 +70,8 @@ exception_init (void)
 void
 exception_print_stats (void)
 {
-  printf ("Exception: %lld page faults\n", page_fault_cnt);
+  printf ("Exception: %lld page faults, %lld on bad user pointers\n",
+          page_fault_cnt, fixup_cnt);
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -135,6 +142,7 @@ page_fault (struct intr_frame *f)
      [IA32-v3a] 5.15 "Interrupt 14--Page Fault Exception
      (#PF)". */
   asm ("movl %%cr2, %0" : "=r" (fault_addr));
+  TRACE (TRACE_PAGE_FAULT, fault_addr, f->eip);
 
   /* Turn interrupts back on (they were only off so that we could
      be assured of reading CR2 before it changed). */
@@ -148,6 +156,20 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+  /* The kernel touched a bad user address in one of the functions
+     in userprog/uaccess.c.  That is expected: resume at its
+     recovery code, which reports the failure to the caller. */
+  if (!user && is_user_vaddr (fault_addr))
+    {
+      uintptr_t fixup = uaccess_fixup ((uintptr_t) f->eip);
+      if (fixup != 0)
+        {
+          fixup_cnt++;
+          f->eip = (void (*) (void)) fixup;
+          return;
+        }
+    }
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
@@ -0,0 +1,201 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+#include "devices/timer.h"
+
+/* Fast user-space mutexes.  A user program keeps its lock or
+   condition state in an ordinary 32-bit word and only calls into
+   the kernel when it has to sleep or wake someone up.
+
+   Sleepers are keyed by the kernel virtual address of the word,
+   that is, by physical frame and offset, not by user address.
+   Two processes that map the same frame at different addresses
+   therefore meet on the same queue.
+
+   There is one queue per word with sleepers, kept in a hash
+   table and freed as soon as its last sleeper leaves. */
+struct futex_queue
+  {
+    struct hash_elem elem;      /* Element in `queues'. */
+    int32_t *key;               /* Kernel address of the word. */
+    struct list waiters;        /* List of struct futex_waiter. */
+  };
+
+/* A thread sleeping in futex_wait(). */
+struct futex_waiter
+  {
+    struct list_elem elem;      /* Element in futex_queue's `waiters'. */
+    struct semaphore sema;      /* Upped to wake the thread. */
+    bool woken;                 /* Removed by futex_wake()? */
+  };
+
+static struct hash queues;
+static struct lock futex_lock;  /* Protects `queues' and every queue. */
+
+static hash_hash_func queue_hash;
+static hash_less_func queue_less;
+static int32_t *futex_key (int32_t *uaddr);
+static struct futex_queue *find_queue (int32_t *key);
+static void put_queue (struct futex_queue *);
+
+/* Initializes the futex wait table. */
+void
+futex_init (void)
+{
+  if (!hash_init (&queues, queue_hash, queue_less, NULL))
+    PANIC ("futex_init: out of memory");
+  lock_init (&futex_lock);
+}
+
+/* If the word at user address UADDR holds EXPECTED, sleeps until
+   futex_wake() is called on the same word or, if MS is not
+   negative, until MS milliseconds have passed.  Returns
+   FUTEX_WOKEN, FUTEX_MISMATCH or FUTEX_TIMEDOUT.
+
+   Comparing the word and going to sleep happen under one lock,
+   so a wakeup sent after the caller changed the word in user
+   space cannot be lost.  UADDR must be a mapped, aligned user
+   address. */
+int
+futex_wait (int32_t *uaddr, int32_t expected, int ms)
+{
+  int32_t *key = futex_key (uaddr);
+  struct futex_queue *q;
+  struct futex_waiter w;
+  bool woken;
+
+  lock_acquire (&futex_lock);
+  if (*key != expected)
+    {
+      lock_release (&futex_lock);
+      return FUTEX_MISMATCH;
+    }
+
+  q = find_queue (key);
+  if (q == NULL)
+    {
+      q = malloc (sizeof *q);
+      if (q == NULL)
+        {
+          /* Behave as if woken at once: callers check the word
+             again anyway. */
+          lock_release (&futex_lock);
+          return FUTEX_WOKEN;
+        }
+      q->key = key;
+      list_init (&q->waiters);
+      hash_insert (&queues, &q->elem);
+    }
+  sema_init (&w.sema, 0);
+  w.woken = false;
+  list_push_back (&q->waiters, &w.elem);
+  lock_release (&futex_lock);
+
+  if (ms < 0)
+    sema_down (&w.sema);
+  else
+    sema_down_timeout (&w.sema, timer_ms_to_ticks (ms));
+
+  /* A wakeup may have come in between the timeout and here.  If
+     so, it counts, since futex_wake() already reported it. */
+  lock_acquire (&futex_lock);
+  woken = w.woken;
+  if (!woken)
+    {
+      list_remove (&w.elem);
+      put_queue (find_queue (key));
+    }
+  lock_release (&futex_lock);
+
+  return woken ? FUTEX_WOKEN : FUTEX_TIMEDOUT;
+}
+
+/* Wakes up at most CNT threads sleeping on the word at user
+   address UADDR, oldest first, and returns how many were woken.
+   UADDR must be a mapped, aligned user address. */
+int
+futex_wake (int32_t *uaddr, int cnt)
+{
+  int32_t *key = futex_key (uaddr);
+  struct futex_queue *q;
+  int woken = 0;
+
+  lock_acquire (&futex_lock);
+  q = find_queue (key);
+  if (q != NULL)
+    {
+      while (woken < cnt && !list_empty (&q->waiters))
+        {
+          struct futex_waiter *w = list_entry (list_pop_front (&q->waiters),
+                                               struct futex_waiter, elem);
+          w->woken = true;
+          sema_up (&w->sema);
+          woken++;
+        }
+      put_queue (q);
+    }
+  lock_release (&futex_lock);
+
+  return woken;
+}
+
+/* Returns the kernel address of the word at user address UADDR
+   in the current process. */
+static int32_t *
+futex_key (int32_t *uaddr)
+{
+  int32_t *key = pagedir_get_page (thread_current ()->pagedir, uaddr);
+
+  ASSERT (key != NULL);
+  ASSERT ((uintptr_t) key % sizeof *key == 0);
+  return key;
+}
+
+/* Returns the queue for KEY, or a null pointer if nobody sleeps
+   on KEY.  futex_lock must be held. */
+static struct futex_queue *
+find_queue (int32_t *key)
+{
+  struct futex_queue q;
+  struct hash_elem *e;
+
+  q.key = key;
+  e = hash_find (&queues, &q.elem);
+  return e != NULL ? hash_entry (e, struct futex_queue, elem) : NULL;
+}
+
+/* Frees Q if nobody sleeps on it any more.  futex_lock must be
+   held. */
+static void
+put_queue (struct futex_queue *q)
+{
+  if (list_empty (&q->waiters))
+    {
+      hash_delete (&queues, &q->elem);
+      free (q);
+    }
+}
+
+/* Hash function for struct futex_queue. */
+static unsigned
+queue_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct futex_queue *q = hash_entry (e, struct futex_queue, elem);
+  return hash_bytes (&q->key, sizeof q->key);
+}
+
+/* Orders struct futex_queue by key. */
+static bool
+queue_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct futex_queue *a = hash_entry (a_, struct futex_queue, elem);
+  const struct futex_queue *b = hash_entry (b_, struct futex_queue, elem);
+
+  return a->key < b->key;
+}
@@ -0,0 +1,15 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdint.h>
+
+/* Results of futex_wait(). */
+#define FUTEX_WOKEN 0           /* Woken by futex_wake(). */
+#define FUTEX_MISMATCH -1       /* *UADDR did not hold the expected value. */
+#define FUTEX_TIMEDOUT -2       /* Timeout expired first. */
+
+void futex_init (void);
+int futex_wait (int32_t *uaddr, int32_t expected, int ms);
+int futex_wake (int32_t *uaddr, int cnt);
+
+#endif /* userprog/futex.h */
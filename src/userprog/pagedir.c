@@ -1,13 +1,20 @@
 #include "userprog/pagedir.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "devices/timer.h"
+
+/* Statistics. */
+static long long cr3_loads;     /* # of writes to CR3. */
+static long long cr3_skips;     /* # of activations needing no write. */
+static long long page_flushes;  /* # of single TLB entries flushed. */
 
 static uint32_t *active_pd (void);
-static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *vaddr);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -152,7 +159,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
@@ -180,7 +187,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -209,19 +216,27 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else
         {
           *pte &= ~(uint32_t) PTE_A;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
 /* Loads page directory PD into the CPU's page directory base
-   register. */
+   register, unless it is already loaded.  Writing CR3 flushes
+   the whole TLB, so it is worth skipping. */
 void
 pagedir_activate (uint32_t *pd)
 {
   if (pd == NULL)
     pd = base_page_dir;
 
+  if (active_pd () == pd)
+    {
+      cr3_skips++;
+      return;
+    }
+  cr3_loads++;
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
@@ -243,21 +258,37 @@ active_pd (void)
   return ptov (pd);
 }
 
-/* Seom page table changes can cause the CPU's translation
+/* Some page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
+   table.  When this happens, we have to "invalidate" the TLB
+   entry for the page that changed.
 
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
+   This function invalidates the TLB entry for VADDR if PD is the
+   active page directory.  (If PD is not active then its entries
+   are not in the TLB, so there is no need to invalidate
+   anything.) */
 static void
-invalidate_pagedir (uint32_t *pd)
+invalidate_page (uint32_t *pd, const void *vaddr)
 {
   if (active_pd () == pd)
     {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
+      /* INVLPG drops just the one entry, where reloading CR3
+         would drop them all.  See [IA32-v2a] "INVLPG" and
+         [IA32-v3a] 3.12 "Translation Lookaside Buffers
+         (TLBs)". */
+      asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
+      page_flushes++;
     }
 }
+
+/* Prints page directory statistics. */
+void
+pagedir_print_stats (void)
+{
+  int64_t seconds = timer_ticks () / TIMER_FREQ;
+
+  printf ("Paging: %lld CR3 loads, %lld skipped (%lld per second), "
+          "%lld single-page TLB flushes\n",
+          cr3_loads, cr3_skips, cr3_skips / (seconds > 0 ? seconds : 1),
+          page_flushes);
+}
@@ -3,82 +3,165 @@
 #include "plist.h"
 #include <stdio.h>
 #include <string.h>
+#include "threads/thread.h"
 
 // Pintos global, so we store it here
 struct process_element plist[PLIST_SIZE];
 
 struct lock plist_lock;
 
+// Used slots by process id, so lookups don't scan all PLIST_SIZE slots
+static struct hash pid_index;
+
+// Unused slots, linked through next_free
+static struct process_element* free_slots;
+
+static unsigned pid_hash(const struct hash_elem* e, void* aux UNUSED)
+{
+    return hash_int(hash_entry(e, struct process_element, pid_elem)->process_id);
+}
+
+static bool pid_less(const struct hash_elem* a, const struct hash_elem* b, void* aux UNUSED)
+{
+    return hash_entry(a, struct process_element, pid_elem)->process_id
+        < hash_entry(b, struct process_element, pid_elem)->process_id;
+}
+
+// Returns the used slot of process_id, or NULL. Caller holds plist_lock.
+static struct process_element* lookup(int process_id)
+{
+    struct process_element key;
+    key.process_id = process_id;
+
+    struct hash_elem* e = hash_find(&pid_index, &key.pid_elem);
+    return (e != NULL) ? hash_entry(e, struct process_element, pid_elem) : NULL;
+}
+
+// Puts p back on the free stack. Caller holds plist_lock.
+static void free_slot(struct process_element* p)
+{
+    ASSERT(p->used);
+
+    // Nobody can wait for dead children anymore, the others lose their parent
+    while (!list_empty(&p->children)) {
+        struct process_element* child =
+            list_entry(list_pop_front(&p->children), struct process_element, child_elem);
+        child->parent_alive = false;
+        if (!child->alive) free_slot(child);
+    }
+
+    if (p->parent_alive) list_remove(&p->child_elem);
+    hash_delete(&pid_index, &p->pid_elem);
+    p->used = false;
+    p->next_free = free_slots;
+    free_slots = p;
+}
+
+// Tells the children of the dead p that their parent is gone. Only the
+// actual children, not the whole table. Caller holds plist_lock.
+static void orphan_children(struct process_element* p)
+{
+    struct list_elem* e = list_begin(&p->children);
+    while (e != list_end(&p->children)) {
+        struct process_element* child = list_entry(e, struct process_element, child_elem);
+        e = list_next(e);
+
+        /* Nobody can wait for a dead child anymore, so free it. A
+           live child frees itself when it exits. */
+        child->parent_alive = false;
+        list_remove(&child->child_elem);
+        if (!child->alive) free_slot(child);
+    }
+}
+
 void plist_init()
 {
-    for (int i = 0; i < PLIST_SIZE; i++) plist[i].used = false;
-    lock_init(&plist_lock);
+    // Must run after malloc_init(), the index allocates its buckets
+    if (!hash_init(&pid_index, pid_hash, pid_less, NULL))
+        PANIC("plist_init: out of memory");
+
+    free_slots = NULL;
+    for (int i = PLIST_SIZE - 1; i >= 0; i--) {
+        plist[i].used = false;
+        plist[i].next_free = free_slots;
+        free_slots = &plist[i];
+    }
+    lock_init_named(&plist_lock, "plist");
 }
 
 int plist_insert(int process_id, char process_name[], int parent_id)
 {
     lock_acquire(&plist_lock);
-    for (int i = 0; i < PLIST_SIZE; i++)
-    {
-        // Find free element
-        if (!plist[i].used) {
-            struct process_element* p = &plist[i];
-            lock_release(&plist_lock);
-
-            struct process_element* p_parent = plist_find(parent_id);
-
-            lock_acquire(&plist_lock);
-            p->process_id = process_id;
-            strlcpy(p->process_name, process_name, PLIST_NAME_SIZE);
-            p->parent_id = parent_id;
-            p->exit_status = -1;
-            p->alive = true;
-            p->parent_alive = (p_parent) ? p_parent->alive : false;
-            p->used = true;
-
-            sema_init(&p->exit_sync, 0);
-
-            lock_release(&plist_lock);
-            return process_id;
-        }
+
+    // Take a free slot
+    struct process_element* p = free_slots;
+    if (p == NULL) {
+        lock_release(&plist_lock);
+        return -1;
     }
+    free_slots = p->next_free;
+
+    struct process_element* p_parent = lookup(parent_id);
+
+    p->process_id = process_id;
+    strlcpy(p->process_name, process_name, PLIST_NAME_SIZE);
+    p->parent_id = parent_id;
+    p->exit_status = -1;
+    p->alive = true;
+    p->parent_alive = (p_parent) ? p_parent->alive : false;
+    // A kernel thread has no slot of its own, but may still wait for me
+    p->kernel_parent = (p_parent == NULL);
+    p->used = true;
+    list_init(&p->children);
+
+    sema_init(&p->exit_sync, 0);
+
+    if (p->parent_alive) list_push_back(&p_parent->children, &p->child_elem);
+    hash_insert(&pid_index, &p->pid_elem);
+
     lock_release(&plist_lock);
-    return -1;
+    return process_id;
 }
 
 struct process_element* plist_find(int process_id)
 {
     lock_acquire(&plist_lock);
-    for (int i = 0; i < PLIST_SIZE; i++) {
-        if (plist[i].process_id == process_id && plist[i].used) {
-            struct process_element* p = &plist[i];
-            lock_release(&plist_lock);
-            return p; // Returns plist element if found and used is true 
-        }
-    }
+    struct process_element* p = lookup(process_id);
+    lock_release(&plist_lock);
+    return p; // Returns plist element if found and used is true
+}
+
+// Frees the slot of a child whose exit status has been collected
+void plist_free(struct process_element* p)
+{
+    lock_acquire(&plist_lock);
+    if (p->used) free_slot(p);
     lock_release(&plist_lock);
-    return NULL;
 }
 
 int plist_remove(int process_id)
 {
-    struct process_element* p = plist_find(process_id);
-    if (p)
-    {   
-        lock_acquire(&plist_lock);
-        /* Remove self and broadcast to children */
-        p->alive = false;
-
-        /* If parent is alive, don't free the position otherwise free it*/
-        p->used = p->parent_alive;
+    lock_acquire(&plist_lock);
+    struct process_element* p = lookup(process_id);
+    if (p == NULL) {
         lock_release(&plist_lock);
-
-        /* Tell all children that I am dead (parent) */
-        plist_broadcast_to_children(p->process_id);
-        
-        return p->process_id;
+        return -1;
     }
-    return -1;
+
+    /* Remove self and tell all children that I am dead (parent), all
+       under one hold of the lock, or my parent could free me meanwhile */
+    p->alive = false;
+    orphan_children(p);
+
+    /* Signal the parent while the slot can't be reused yet. If the
+       parent is alive, or is a kernel thread like main() that may be
+       blocked in process_wait(), it frees the position after wait.
+       Otherwise nobody will, so free it now. */
+    sema_up(&p->exit_sync);
+    if (!p->parent_alive && !p->kernel_parent) free_slot(p);
+    lock_release(&plist_lock);
+
+    return process_id;
 }
 
 void plist_purge(void)
@@ -88,17 +171,9 @@ void plist_purge(void)
 
 void plist_broadcast_to_children(int parent_id)
 {
-    struct process_element* p_parent = plist_find(parent_id);
-
     lock_acquire(&plist_lock);
-    for (int i = 0; i < PLIST_SIZE; i++) {
-        struct process_element* p = &plist[i];
-        if (p->parent_id == parent_id && p->used) {   
-            /* Updates to parent's alive status, if parent does not exist set to false */
-            p->parent_alive = (p_parent != NULL) ? p_parent->alive : false;
-            p->used = (p_parent != NULL) ? p_parent->alive : false;
-        }
-    }
+    struct process_element* p_parent = lookup(parent_id);
+    if (p_parent != NULL && !p_parent->alive) orphan_children(p_parent);
     lock_release(&plist_lock);
 }
 
@@ -107,20 +182,30 @@ void plist_print_all()
     lock_acquire(&plist_lock);
     int count = 0;
     // Print table header
-    printf("ProcessID\tProcessName\tParentID\tExitStatus\tAlive\tParentAlive\n");
-    printf("---------\t-----------\t--------\t----------\t-----\t-----------\n");
+    printf("ProcessID\tProcessName\tParentID\tExitStatus\tAlive\tParentAlive\tVoluntary\tInvoluntary\n");
+    printf("---------\t-----------\t--------\t----------\t-----\t-----------\t---------\t-----------\n");
     for (int i = 0; i< PLIST_SIZE; i++) {
         struct process_element* p = &plist[i];
         if (p->used)
         {
+            // Context switches, only known while the thread still exists
+            char voluntary[24] = "-", involuntary[24] = "-";
+            long long vol, invol;
+            if (p->alive && thread_get_switches(p->process_id, &vol, &invol)) {
+                snprintf(voluntary, sizeof voluntary, "%lld", vol);
+                snprintf(involuntary, sizeof involuntary, "%lld", invol);
+            }
+
             // Align values to table header
-            printf("%9d\t%11s\t%8d\t%10d\t%5s\t%11s\n",
+            printf("%9d\t%11s\t%8d\t%10d\t%5s\t%11s\t%9s\t%11s\n",
                     p->process_id,
                     p->process_name,
                     p->parent_id,
                     p->exit_status,
                     (p->alive) ? "true" : "false",
-                    (p->parent_alive) ? "true" : "false");
+                    (p->parent_alive) ? "true" : "false",
+                    voluntary,
+                    involuntary);
             count++;
         }
     }
@@ -2,6 +2,8 @@
 #define _PLIST_H_
 
 #include <stdbool.h>
+#include <hash.h>
+#include <list.h>
 #include <threads/synch.h>
 
 /* Place functions to handle a running process here (process list).
@@ -42,14 +44,21 @@ struct process_element {
   int exit_status;
   bool alive;
   bool parent_alive;
+  bool kernel_parent;                     // Parent is a kernel thread, e.g. main
   bool used;
   struct semaphore exit_sync;
+
+  struct hash_elem pid_elem;              // In the pid index while used
+  struct list children;                   // Children, by child_elem
+  struct list_elem child_elem;            // In the parent's children
+  struct process_element* next_free;      // Free slot stack link
 };
 
 void plist_init(void);
 int plist_insert(int process_id, char process_name[], int parent_id);
 struct process_element* plist_find(int process_id);
 int plist_remove(int process_id);
+void plist_free(struct process_element* p);
 void plist_purge(void);
 void plist_broadcast_to_children(int parent_id);
 void plist_print_all(void);
@@ -13,14 +13,18 @@
 #include "threads/vaddr.h"     /* PHYS_BASE */
 #include "threads/interrupt.h" /* if_ */
 #include "threads/init.h"      /* power_off() */
+#include "threads/mp.h"        /* mp_leave_kernel() */
+#include "threads/cpu.h"       /* cpu_cnt */
 
 /* Headers not yet used that you may need for various reasons. */
 #include "threads/synch.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
 #include "lib/kernel/list.h"
 
 #include "userprog/flist.h"
 #include "userprog/plist.h"
+#include "userprog/ring.h"
 
 /* HACK defines code you must remove and implement in a proper way */
 #define HACK
@@ -41,7 +45,7 @@ void process_init(void)
 void process_exit(int status)
 {
    struct process_element *p = plist_find(thread_current()->tid);
-   p->exit_status = status;
+   if (p) p->exit_status = status;
 }
 
 /* Print a list of all running processes. The list shall include all
@@ -210,7 +214,11 @@ start_process (struct parameters_to_start_process* parameters)
      implemented by intr_exit (in threads/intr-stubs.S). Because
      intr_exit takes all of its arguments on the stack in the form of
      a `struct intr_frame', we just point the stack pointer (%esp) to
-     our stack frame and jump to it. */
+     our stack frame and jump to it.  The user program runs
+     without the big kernel lock, and intr_exit turns interrupts
+     back on only as it leaves the kernel. */
+  intr_disable ();
+  mp_leave_kernel ();
   asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
   NOT_REACHED ();
 }
@@ -226,6 +234,16 @@ start_process (struct parameters_to_start_process* parameters)
    mechanism between parent and child is established. */
 int
 process_wait (int child_id)
+{
+  return process_wait_timeout (child_id, -1);
+}
+
+/* Like process_wait(), but gives up after `ms' milliseconds and
+   returns PROCESS_WAIT_TIMEOUT if the child is still running. The
+   child can then be waited for again. A negative `ms' waits
+   forever. */
+int
+process_wait_timeout (int child_id, int ms)
 {
   int status = -1;
   struct thread *cur = thread_current ();
@@ -236,9 +254,12 @@ process_wait (int child_id)
    struct process_element *p_child = plist_find(child_id);
    
    if(p_child != NULL){
-     sema_down(&p_child->exit_sync);
+     if (ms < 0)
+       sema_down(&p_child->exit_sync);
+     else if (!sema_down_timeout(&p_child->exit_sync, timer_ms_to_ticks(ms)))
+       return PROCESS_WAIT_TIMEOUT;
      status = p_child->exit_status;
-     p_child->used = false; // Meaning slot is now free in plist, runtime is over
+     plist_free(p_child); // Meaning slot is now free in plist, runtime is over
    }
 
   debug("%s#%d: process_wait(%d) RETURNS %d\n",
@@ -287,10 +308,11 @@ process_cleanup (void)
 			and clear its file table, useful in crash situations too
 		*/
       flist_purge(&cur->file_table);
-      plist_remove(cur->tid); 
-      sema_up(&p->exit_sync); // signal parent that we are done
+      plist_remove(cur->tid); // also signals parent that we are done
    }
 
+   ring_release();
+
    /* Destroy the current process's page directory and switch back
       to the kernel-only page directory. */
    if (pd != NULL)
@@ -318,8 +340,24 @@ process_activate (void)
 {
   struct thread *t = thread_current ();
 
-  /* Activate thread's page tables. */
-  pagedir_activate (t->pagedir);
+  /* Activate thread's page tables.  A kernel thread has none of
+     its own and never touches user memory, so on a single
+     processor it borrows whichever page directory is loaded:
+     every page directory maps the kernel the same way.
+     Switching from a process to a kernel thread and back to the
+     same process then needs no TLB flush at all.  This is safe
+     because a process switches to the base page directory in
+     process_cleanup() before its own is destroyed, so no one can
+     be borrowing it.
+
+     With several processors that no longer holds: the process
+     may move to another processor and exit there while a kernel
+     thread here still has its page directory loaded.  Kernel
+     threads then use the base page directory. */
+  if (t->pagedir != NULL)
+    pagedir_activate (t->pagedir);
+  else if (cpu_cnt > 1)
+    pagedir_activate (NULL);
 
   /* Set thread's kernel stack for use in processing
      interrupts. */
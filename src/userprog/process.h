@@ -8,9 +8,14 @@ void process_print_list (void);
 void process_exit (int status);
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
+int process_wait_timeout (tid_t, int ms);
 void process_cleanup (void);
 void process_activate (void);
 
+/* Returned by process_wait_timeout() when the child did not exit
+   in time. */
+#define PROCESS_WAIT_TIMEOUT -2
+
 /* This is unacceptable solutions. */
 #define INFINITE_WAIT() for ( ; ; ) thread_yield()
 #define BUSY_WAIT(n)       \
@@ -0,0 +1,138 @@
+#include "userprog/ring.h"
+#include <debug.h>
+#include <stddef.h>
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
+
+/* Batched system calls.  A process registers a struct ring in
+   its own memory with ring_setup(), queues file system calls on
+   its submission ring and runs a whole batch with one
+   ring_enter() call, which leaves the results on the completion
+   ring.  That saves a trap per operation.
+
+   The kernel accesses the rings through the user addresses, in
+   the process's own address space, so the memory is shared
+   without mapping anything.  It keeps its own copies of the
+   counters it owns, so a process that scribbles over them can
+   only confuse itself. */
+struct ring_ctx
+  {
+    struct ring *uring;         /* User address of the rings. */
+    uint32_t sq_head;           /* Next submission to run. */
+    uint32_t cq_tail;           /* Next completion to fill. */
+  };
+
+static void get_counter (uint32_t *, const uint32_t *ucounter);
+static void put_counter (uint32_t *ucounter, uint32_t);
+
+/* Registers URING as the running process's rings and empties
+   them.  Returns 0 if successful, -1 if the process already has
+   rings or memory is short. */
+int
+ring_setup (struct ring *uring)
+{
+  struct thread *t = thread_current ();
+  struct ring_ctx *ctx;
+
+  if (t->ring != NULL)
+    return -1;
+
+  ctx = malloc (sizeof *ctx);
+  if (ctx == NULL)
+    return -1;
+  ctx->uring = uring;
+  ctx->sq_head = ctx->cq_tail = 0;
+  t->ring = ctx;
+
+  put_counter (&uring->sq_head, 0);
+  put_counter (&uring->sq_tail, 0);
+  put_counter (&uring->cq_head, 0);
+  put_counter (&uring->cq_tail, 0);
+  return 0;
+}
+
+/* Runs up to N_SUBMIT queued operations, in order, and returns
+   how many it ran, or -1 if the process has no rings or their
+   counters make no sense.  Stops early when the submission ring
+   is empty or the completion ring is full.
+
+   Operations run to completion inside this call, so every one
+   of them has a completion on return and there is never anything
+   to wait for: MIN_COMPLETE is only there to keep the shape of
+   io_uring_enter().
+
+   A bad pointer in an operation kills the process, just like the
+   same system call made directly would. */
+int
+ring_enter (unsigned n_submit, unsigned min_complete UNUSED)
+{
+  struct ring_ctx *ctx = thread_current ()->ring;
+  struct ring *uring;
+  uint32_t sq_tail, cq_head;
+  unsigned done = 0;
+
+  if (ctx == NULL)
+    return -1;
+  uring = ctx->uring;
+
+  get_counter (&sq_tail, &uring->sq_tail);
+  get_counter (&cq_head, &uring->cq_head);
+  if (sq_tail - ctx->sq_head > RING_ENTRIES
+      || ctx->cq_tail - cq_head > RING_ENTRIES)
+    return -1;
+
+  while (done < n_submit && ctx->sq_head != sq_tail
+         && ctx->cq_tail - cq_head < RING_ENTRIES)
+    {
+      struct ring_sqe sqe;
+      struct ring_cqe cqe;
+
+      if (!copy_from_user (&sqe, &uring->sq[ctx->sq_head % RING_ENTRIES],
+                           sizeof sqe))
+        thread_exit ();
+      ctx->sq_head++;
+
+      cqe.result = syscall_run (sqe.nr, sqe.args);
+      cqe.user_data = sqe.user_data;
+      if (!copy_to_user (&uring->cq[ctx->cq_tail % RING_ENTRIES], &cqe,
+                         sizeof cqe))
+        thread_exit ();
+      ctx->cq_tail++;
+      done++;
+    }
+
+  put_counter (&uring->sq_head, ctx->sq_head);
+  put_counter (&uring->cq_tail, ctx->cq_tail);
+  return done;
+}
+
+/* Forgets the running process's rings, if any.  Called when the
+   process exits. */
+void
+ring_release (void)
+{
+  struct thread *t = thread_current ();
+
+  free (t->ring);
+  t->ring = NULL;
+}
+
+/* Reads the ring counter at user address UCOUNTER into
+   *COUNTER.  Kills the process if it is not readable. */
+static void
+get_counter (uint32_t *counter, const uint32_t *ucounter)
+{
+  if (!copy_from_user (counter, ucounter, sizeof *counter))
+    thread_exit ();
+}
+
+/* Writes COUNTER to the ring counter at user address UCOUNTER.
+   Kills the process if it is not writable. */
+static void
+put_counter (uint32_t *ucounter, uint32_t counter)
+{
+  if (!copy_to_user (ucounter, &counter, sizeof counter))
+    thread_exit ();
+}
@@ -0,0 +1,10 @@
+#ifndef USERPROG_RING_H
+#define USERPROG_RING_H
+
+#include <ring.h>
+
+int ring_setup (struct ring *);
+int ring_enter (unsigned n_submit, unsigned min_complete);
+void ring_release (void);
+
+#endif /* userprog/ring.h */
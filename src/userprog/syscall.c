@@ -1,73 +1,121 @@
 #include <stdio.h>
 #include <syscall-nr.h>
+#include <timespec.h>
+#include <sysstat.h>
+#include <iovec.h>
 #include "userprog/syscall.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/synch.h"
+#include "threads/trace.h"
+#include "threads/io.h"
 
 /* header files you probably need, they are not used yet */
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include "filesys/directory.h"
 #include "threads/vaddr.h"
 #include "threads/init.h"
+#include "threads/palloc.h"
 #include "userprog/pagedir.h"
 #include "userprog/process.h"
+#include "userprog/futex.h"
+#include "userprog/uaccess.h"
+#include "userprog/ring.h"
 #include "devices/input.h"
 #include "devices/timer.h"
 
 static void syscall_handler (struct intr_frame *);
+static bool verify_fix_length(void* start, unsigned length);
+
+/* Handles one system call. ARGS[0] is the system call number and
+   ARGS[1...] its arguments, already copied into the kernel. The
+   result goes into F->eax. */
+typedef void syscall_func (struct intr_frame *f, int32_t* args);
+
+/* What a system call argument is, for the checks done before the
+   handler runs. Strings and ARG_OUT structures are copied by the
+   handler with the functions in userprog/uaccess.h, or through
+   userprog/ring.c, which check them on the way. */
+enum arg_kind
+  {
+    ARG_VAL,                    /* Not a pointer. */
+    ARG_STR,                    /* String, copied by the handler. */
+    ARG_OUT,                    /* Structure, copied by the handler. */
+    ARG_BUF,                    /* Array of ELEM_SIZE elements, the
+                                   count in the next argument. */
+    ARG_WORD,                   /* Aligned int32_t futex word. */
+    ARG_IOV                     /* Array of struct iovec, the count in
+                                   the next argument. Copied and
+                                   checked by the handler. */
+  };
+
+struct syscall_desc
+  {
+    syscall_func *func;         /* Handler, null if not implemented. */
+    const char *name;           /* Name, for sysstat. */
+    int argc;                   /* Number of arguments. */
+    enum arg_kind kind[4];      /* Kind of each argument. */
+    size_t elem_size;           /* Element size of an ARG_BUF argument. */
+  };
 
 void
 syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  futex_init ();
 }
 
-/* This array defined the number of arguments each syscall expects.
-   For example, if you want to find out the number of arguments for
-   the read system call you shall write:
-
-   int sys_read_arg_count = argc[ SYS_READ ];
-
-   All system calls have a name such as SYS_READ defined as an enum
-   type, see `lib/syscall-nr.h'. Use them instead of numbers.
- */
-const int argc[] = {
-  /* basic calls */
-  0, 1, 1, 1, 2, 1, 1, 1, 3, 3, 2, 1, 1,
-  /* not implemented */
-  2, 1,    1, 1, 2, 1, 1,
-  /* extended, you may need to change the order of these two (plist, sleep) */
-  0, 1
-};
+static void
+halt (struct intr_frame *f UNUSED, int32_t* args UNUSED)
+{
+  power_off();
+}
 
 static void
-exit (int32_t* esp)
+exit (struct intr_frame *f UNUSED, int32_t* args)
 {
-  int exit_status = esp[1];
+  int exit_status = args[1];
   process_exit(exit_status);
   thread_exit ();
 }
 
+// Copies a file name from user memory into name, kills the process on a
+// bad pointer. Returns false if the name is too long to name any file.
+static bool
+get_file_name (char name[NAME_MAX + 2], const char* uname)
+{
+  int len = strncpy_from_user(name, uname, NAME_MAX + 2);
+  if (len < 0) thread_exit();
+  return len <= NAME_MAX;
+}
+
 static void
-create (struct intr_frame *f, int32_t* esp)
+create (struct intr_frame *f, int32_t* args)
 {
-  const char* filename = (char*)esp[1];
-  unsigned initial_size = esp[2];
-  f->eax = filesys_create(filename, initial_size); // return success
+  char filename[NAME_MAX + 2];
+  unsigned initial_size = args[2];
+  f->eax = get_file_name(filename, (char*)args[1])
+    && filesys_create(filename, initial_size); // return success
 }
 
 static void
-remove (struct intr_frame *f, int32_t* esp)
+remove (struct intr_frame *f, int32_t* args)
 {
-  const char *filename = (char*)esp[1];
-  f->eax = filesys_remove(filename); // return success
+  char filename[NAME_MAX + 2];
+  f->eax = get_file_name(filename, (char*)args[1])
+    && filesys_remove(filename); // return success
 }
 
 static void
-open (struct intr_frame *f, int32_t* esp)
+open (struct intr_frame *f, int32_t* args)
 {
-  const char* filename = (char*)esp[1];
+  char filename[NAME_MAX + 2];
+  if (!get_file_name(filename, (char*)args[1])) {
+    f->eax = -1;
+    return;
+  }
   struct thread* t = thread_current(); // Get current thread
   struct file* file = filesys_open(filename); // Struct file, inode & curr pos
 
@@ -76,10 +124,10 @@ open (struct intr_frame *f, int32_t* esp)
 }
 
 static void
-close (int32_t* esp)
+close (struct intr_frame *f UNUSED, int32_t* args)
 {
   struct thread* t = thread_current();
-  const int fd = esp[1];
+  const int fd = args[1];
   struct file* file = flist_find(&t->file_table, fd);
 
   if(file) {
@@ -88,56 +136,52 @@ close (int32_t* esp)
   }
 }
 
-static void
-read (struct intr_frame *f, int32_t* esp)
+// Reads from fd like read, for read and readv. The buffer is checked.
+static int
+read_fd (int fd, char* buffer, unsigned length)
 {
-  const int fd = esp[1];
-  char* buffer = (char*)esp[2];
-  unsigned length = esp[3];
-
   // Read from stdin
   if (fd == STDIN_FILENO) {
     for(unsigned i = 0; i < length; i++) {
 
       // Get input
-      buffer[i] = input_getc();
+      char c = input_getc();
 
       // Replace \r with \n
-      if (buffer[i] == '\r') buffer[i] = '\n';
+      if (c == '\r') c = '\n';
+
+      if (!copy_to_user(&buffer[i], &c, 1)) thread_exit();
 
       // Display input (single character)
-      putbuf(&buffer[i], 1);
+      putbuf(&c, 1);
     }
 
-    f->eax = length; // return length
+    return length;
 
   } else if(fd >= 2 && fd <= 32) {
     struct thread* t = thread_current();
     struct file* file = flist_find(&(t->file_table), fd);
 
     // Read and return bytes read if file exists, else return error
-    f->eax = (file != NULL) ? file_read(file, buffer, length) : -1;
+    return (file != NULL) ? file_read(file, buffer, length) : -1;
     
   // Error
   } else {
-    f->eax = -1; // return -1
+    return -1;
   }
 }
 
-static void
-write (struct intr_frame *f, int32_t* esp)
+// Writes to fd like write, for write and writev. The buffer is checked.
+static int
+write_fd (int fd, const char* buffer, unsigned length)
 {
-  const int fd = esp[1];
-  char* buffer = (char*)esp[2];
-  unsigned length = esp[3];
-
   // Write to stdout
   if (fd == STDOUT_FILENO) {
     
     // Display buffer
     putbuf(buffer, length);
 
-    f->eax = length; // return length
+    return length;
 
   // Write to file
   } else if(fd >= 2 && fd <= 32) {
@@ -145,18 +189,144 @@ write (struct intr_frame *f, int32_t* esp)
     struct file* file = flist_find(&(t->file_table), fd);
 
     // Write and return bytes written if file exists, else return error
-    f->eax = (file != NULL) ? file_write(file, buffer, length) : -1;
+    return (file != NULL) ? file_write(file, buffer, length) : -1;
 
   // Error
   } else {
-    f->eax = -1; // return -1
+    return -1;
   }
 }
 
 static void
-filesize (struct intr_frame *f, int32_t* esp)
+read (struct intr_frame *f, int32_t* args)
 {
-  const int fd = esp[1];
+  const int fd = args[1];
+  char* buffer = (char*)args[2];
+  unsigned length = args[3];
+
+  f->eax = read_fd(fd, buffer, length);
+}
+
+static void
+write (struct intr_frame *f, int32_t* args)
+{
+  const int fd = args[1];
+  const char* buffer = (char*)args[2];
+  unsigned length = args[3];
+
+  f->eax = write_fd(fd, buffer, length);
+}
+
+// Returns the open file fd, or NULL if fd is not an open file
+static struct file*
+find_file (int fd)
+{
+  if (fd < 2 || fd > 32) return NULL;
+  return flist_find(&thread_current()->file_table, fd);
+}
+
+static void
+pread (struct intr_frame *f, int32_t* args)
+{
+  struct file* file = find_file(args[1]);
+  char* buffer = (char*)args[2];
+  unsigned length = args[3];
+  off_t offset = args[4];
+
+  // At offset, without moving the file position
+  f->eax = (file != NULL && offset >= 0) ? file_read_at(file, buffer, length, offset) : -1;
+}
+
+static void
+pwrite (struct intr_frame *f, int32_t* args)
+{
+  struct file* file = find_file(args[1]);
+  const char* buffer = (char*)args[2];
+  unsigned length = args[3];
+  off_t offset = args[4];
+
+  // At offset, without moving the file position
+  f->eax = (file != NULL && offset >= 0) ? file_write_at(file, buffer, length, offset) : -1;
+}
+
+/* Copies the iovec array of readv or writev into iov and checks every
+   buffer in it, in one pass before any I/O. Kills the process on a bad
+   pointer. Returns the number of buffers, or -1 if there are too many
+   or they add up to more than fits in the result. */
+static int
+get_iovec (struct iovec iov[IOV_MAX], const struct iovec* uiov, int cnt)
+{
+  size_t total = 0;
+
+  if (cnt < 0 || cnt > IOV_MAX) return -1;
+  if (!copy_from_user(iov, uiov, cnt * sizeof *iov)) thread_exit();
+
+  for (int i = 0; i < cnt; i++) {
+    if (iov[i].iov_len > INT32_MAX - total) return -1;
+    total += iov[i].iov_len;
+
+    if (iov[i].iov_len > 0 && !verify_fix_length(iov[i].iov_base, iov[i].iov_len))
+      thread_exit();
+  }
+  return cnt;
+}
+
+static void
+readv (struct intr_frame *f, int32_t* args)
+{
+  const int fd = args[1];
+  struct iovec iov[IOV_MAX];
+  int cnt = get_iovec(iov, (struct iovec*)args[2], args[3]);
+  int total = 0;
+
+  if (cnt < 0) {
+    f->eax = -1;
+    return;
+  }
+
+  // Fill the buffers in order, stop at a short read
+  for (int i = 0; i < cnt; i++) {
+    int n = read_fd(fd, iov[i].iov_base, iov[i].iov_len);
+    if (n < 0) {
+      f->eax = (total > 0) ? total : -1;
+      return;
+    }
+    total += n;
+    if ((size_t) n < iov[i].iov_len) break;
+  }
+  f->eax = total;
+}
+
+static void
+writev (struct intr_frame *f, int32_t* args)
+{
+  const int fd = args[1];
+  struct iovec iov[IOV_MAX];
+  int cnt = get_iovec(iov, (struct iovec*)args[2], args[3]);
+  int total = 0;
+
+  if (cnt < 0) {
+    f->eax = -1;
+    return;
+  }
+
+  // Write the buffers in order, stop at a short write
+  for (int i = 0; i < cnt; i++) {
+    int n = write_fd(fd, iov[i].iov_base, iov[i].iov_len);
+    if (n < 0) {
+      f->eax = (total > 0) ? total : -1;
+      return;
+    }
+    total += n;
+    if ((size_t) n < iov[i].iov_len) break;
+  }
+  f->eax = total;
+}
+
+static void
+filesize (struct intr_frame *f, int32_t* args)
+{
+  const int fd = args[1];
   struct thread* t = thread_current();
   struct file* file = flist_find(&t->file_table, fd);
 
@@ -165,10 +335,10 @@ filesize (struct intr_frame *f, int32_t* esp)
 }
 
 static void
-seek (int32_t* esp)
+seek (struct intr_frame *f UNUSED, int32_t* args)
 {
-  const int fd = esp[1];
-  const unsigned newPosition = esp[2];
+  const int fd = args[1];
+  const unsigned newPosition = args[2];
   struct thread* t = thread_current();
   struct file* file = flist_find(&t->file_table, fd);
   const unsigned filesize = file_length(file);
@@ -178,9 +348,9 @@ seek (int32_t* esp)
 }
 
 static void
-tell (struct intr_frame *f, int32_t* esp)
+tell (struct intr_frame *f, int32_t* args)
 {
-  const int fd = esp[1];
+  const int fd = args[1];
   struct thread* t = thread_current();
   struct file* file = flist_find(&t->file_table, fd);
 
@@ -189,38 +359,192 @@ tell (struct intr_frame *f, int32_t* esp)
 }
 
 static void
-sleep (int32_t* esp)
+sleep (struct intr_frame *f UNUSED, int32_t* args)
 {
-  int64_t ms = (int64_t) esp[1];
+  int64_t ms = (int64_t) args[1];
   timer_msleep(ms);
 }
 
 static void
-plist (void)
+plist (struct intr_frame *f UNUSED, int32_t* args UNUSED)
 {
   process_print_list();
 }
 
 static void
-exec (struct intr_frame *f, int32_t* esp)
+lockstat (struct intr_frame *f, int32_t* args)
+{
+  struct lockstat* stats = (struct lockstat*)args[1];
+  int max = args[2];
+
+  // Fill at most max entries, most contended lock first
+  f->eax = lock_get_stats(stats, max);
+}
+
+static void
+exec (struct intr_frame *f, int32_t* args)
 {
-  char* file_name = (char*) esp[1];
+  // A command line must fit in the page the new process's stack starts with
+  char* cmd_line = palloc_get_page(0);
+  if (cmd_line == NULL) {
+    f->eax = -1;
+    return;
+  }
 
-  int process_id = process_execute(file_name);
+  int len = strncpy_from_user(cmd_line, (char*) args[1], PGSIZE);
+  if (len < 0) {
+    palloc_free_page(cmd_line);
+    thread_exit();
+  }
+
+  int process_id = (len < PGSIZE) ? process_execute(cmd_line) : -1;
+  palloc_free_page(cmd_line);
 
   f->eax = (uint32_t) process_id;
 }
 
 static void
-wait (struct intr_frame *f, int32_t* esp)
+wait (struct intr_frame *f, int32_t* args)
 {
   // Child process id
-  int process_id = (int) esp[1];
+  int process_id = (int) args[1];
 
   // Wait for child process to finish
   f->eax = (uint32_t) process_wait(process_id);
 }
 
+static void
+wait_timeout (struct intr_frame *f, int32_t* args)
+{
+  int process_id = (int) args[1];
+  int ms = (int) args[2];
+
+  // Wait for child process to finish, but at most ms milliseconds
+  f->eax = (uint32_t) process_wait_timeout(process_id, ms);
+}
+
+static void
+clock_gettime (struct intr_frame *f, int32_t* args)
+{
+  int clock_id = (int) args[1];
+  struct timespec* uts = (struct timespec*)args[2];
+  struct timespec ts;
+
+  if (clock_id != CLOCK_MONOTONIC) {
+    f->eax = -1;
+    return;
+  }
+
+  // Nanoseconds since boot, from the time stamp counter
+  int64_t ns = timer_nanos();
+  ts.tv_sec = ns / 1000000000;
+  ts.tv_nsec = ns % 1000000000;
+  if (!copy_to_user(uts, &ts, sizeof ts)) thread_exit();
+  f->eax = 0;
+}
+
+// Prefixed, since userprog/futex.h already has the plain names
+static void
+sys_futex_wait (struct intr_frame *f, int32_t* args)
+{
+  int32_t* addr = (int32_t*)args[1];
+  int32_t expected = args[2];
+  int ms = (int) args[3];
+
+  // Sleep only if *addr still holds the expected value
+  f->eax = futex_wait(addr, expected, ms);
+}
+
+static void
+sys_futex_wake (struct intr_frame *f, int32_t* args)
+{
+  int32_t* addr = (int32_t*)args[1];
+  int cnt = (int) args[2];
+
+  // Returns the number of woken threads
+  f->eax = futex_wake(addr, cnt);
+}
+
+static void
+sys_ring_setup (struct intr_frame *f, int32_t* args)
+{
+  struct ring* ring = (struct ring*)args[1];
+
+  f->eax = ring_setup(ring);
+}
+
+static void
+sys_ring_enter (struct intr_frame *f, int32_t* args)
+{
+  unsigned n_submit = args[1];
+  unsigned min_complete = args[2];
+
+  // Runs the queued operations, each through syscall_run()
+  f->eax = ring_enter(n_submit, min_complete);
+}
+
+// Per syscall statistics, returned by sysstat. Updated with interrupts off.
+static struct sysstat stats[SYS_NUMBER_OF_CALLS];
+
+static const struct syscall_desc syscalls[SYS_NUMBER_OF_CALLS];
+
+static void
+sysstat (struct intr_frame *f, int32_t* args)
+{
+  struct sysstat* ustats = (struct sysstat*)args[1];
+  int max = args[2];
+  int cnt = 0;
+
+  // One entry per implemented syscall, in syscall number order
+  for (int nr = 0; nr < SYS_NUMBER_OF_CALLS && cnt < max; nr++) {
+    if (syscalls[nr].func == NULL) continue;
+
+    enum intr_level old_level = intr_disable();
+    struct sysstat s = stats[nr];
+    intr_set_level(old_level);
+
+    strlcpy(s.name, syscalls[nr].name, sizeof s.name);
+    if (!copy_to_user(&ustats[cnt], &s, sizeof s)) thread_exit();
+    cnt++;
+  }
+  f->eax = cnt;
+}
+
+/* Each system call is described by its handler, its number of
+   arguments and what its pointer arguments point to. KIND[i]
+   describes argument i + 1, that is, args[i + 1]. */
+static const struct syscall_desc syscalls[SYS_NUMBER_OF_CALLS] = {
+  [SYS_HALT]          = { halt, "halt", 0, { 0 }, 0 },
+  [SYS_EXIT]          = { exit, "exit", 1, { 0 }, 0 },
+  [SYS_EXEC]          = { exec, "exec", 1, { ARG_STR }, 0 },
+  [SYS_WAIT]          = { wait, "wait", 1, { 0 }, 0 },
+  [SYS_CREATE]        = { create, "create", 2, { ARG_STR, ARG_VAL }, 0 },
+  [SYS_REMOVE]        = { remove, "remove", 1, { ARG_STR }, 0 },
+  [SYS_OPEN]          = { open, "open", 1, { ARG_STR }, 0 },
+  [SYS_FILESIZE]      = { filesize, "filesize", 1, { 0 }, 0 },
+  [SYS_READ]          = { read, "read", 3, { ARG_VAL, ARG_BUF, ARG_VAL }, 1 },
+  [SYS_WRITE]         = { write, "write", 3, { ARG_VAL, ARG_BUF, ARG_VAL }, 1 },
+  [SYS_SEEK]          = { seek, "seek", 2, { 0 }, 0 },
+  [SYS_TELL]          = { tell, "tell", 1, { 0 }, 0 },
+  [SYS_CLOSE]         = { close, "close", 1, { 0 }, 0 },
+  [SYS_SLEEP]         = { sleep, "sleep", 1, { 0 }, 0 },
+  [SYS_PLIST]         = { plist, "plist", 0, { 0 }, 0 },
+  [SYS_LOCKSTAT]      = { lockstat, "lockstat", 2, { ARG_BUF, ARG_VAL }, sizeof(struct lockstat) },
+  [SYS_WAIT_TIMEOUT]  = { wait_timeout, "wait_timeout", 2, { 0 }, 0 },
+  [SYS_CLOCK_GETTIME] = { clock_gettime, "clock_gettime", 2, { ARG_VAL, ARG_OUT }, 0 },
+  [SYS_FUTEX_WAIT]    = { sys_futex_wait, "futex_wait", 3, { ARG_WORD, ARG_VAL, ARG_VAL }, 0 },
+  [SYS_FUTEX_WAKE]    = { sys_futex_wake, "futex_wake", 2, { ARG_WORD, ARG_VAL }, 0 },
+  [SYS_SYSSTAT]       = { sysstat, "sysstat", 2, { ARG_OUT, ARG_VAL }, 0 },
+  [SYS_RING_SETUP]    = { sys_ring_setup, "ring_setup", 1, { ARG_OUT }, 0 },
+  [SYS_RING_ENTER]    = { sys_ring_enter, "ring_enter", 2, { 0 }, 0 },
+  [SYS_PREAD]         = { pread, "pread", 4, { ARG_VAL, ARG_BUF, ARG_VAL, ARG_VAL }, 1 },
+  [SYS_PWRITE]        = { pwrite, "pwrite", 4, { ARG_VAL, ARG_BUF, ARG_VAL, ARG_VAL }, 1 },
+  [SYS_READV]         = { readv, "readv", 3, { ARG_VAL, ARG_IOV, ARG_VAL }, 0 },
+  [SYS_WRITEV]        = { writev, "writev", 3, { ARG_VAL, ARG_IOV, ARG_VAL }, 0 },
+  /* Not implemented: mmap, munmap, chdir, mkdir, readdir, isdir,
+     inumber. Their entries stay zero. */
+};
+
 static bool verify_fix_length(void* start, unsigned length)
 {
   // Null pointer
@@ -239,80 +563,121 @@ static bool verify_fix_length(void* start, unsigned length)
   return true;
 }
 
-static bool verify_variable_length(char* start)
+// Checks the pointer arguments the handler can't check itself, in one
+// pass over the descriptor. Returns false if one of them is bad.
+static bool
+check_args (const struct syscall_desc* desc, int32_t* args)
 {
-  // Null pointer or address in kernel space
-  if(start == NULL || is_kernel_vaddr(start)) return false;
+  for (int i = 0; i < desc->argc; i++) {
+    void* ptr = (void*)args[i + 1];
+
+    switch (desc->kind[i]) {
+      case ARG_BUF: {
+        // Code outside this file fills or reads it and can't recover from a
+        // fault, so check every page. The element count is the next argument.
+        uint32_t cnt = args[i + 2];
+        if (cnt > (uint32_t)PHYS_BASE / desc->elem_size
+            || !verify_fix_length(ptr, cnt * desc->elem_size))
+          return false;
+        break;
+      }
+      case ARG_WORD:
+        // The futex code reads it through its kernel address, so it must be
+        // mapped, and aligned so that it lies within one page
+        if ((uint32_t)ptr % sizeof(int32_t) != 0 || !verify_fix_length(ptr, sizeof(int32_t)))
+          return false;
+        break;
+      default:
+        // Plain values, and pointers the handler copies through uaccess
+        break;
+    }
+  }
+  return true;
+}
 
-  struct thread* t = thread_current();
+// Returns the histogram bucket for a call that took cycles cycles
+static int
+latency_bucket (uint64_t cycles)
+{
+  if (cycles >> 32 != 0) return SYSSTAT_BUCKETS - 1;
 
-  /* To detect page changes */
-  unsigned current_page = pg_no(start);
+  int bucket = 31 - __builtin_clz((uint32_t)cycles | 1);
+  return (bucket < SYSSTAT_BUCKETS) ? bucket : SYSSTAT_BUCKETS - 1;
+}
 
-  /* Check that the start address is valid */
-  if (pagedir_get_page(t->pagedir, start) == NULL) return false;
+// Checks the arguments and runs the handler of desc, counting the call
+static void
+dispatch (struct intr_frame *f, const struct syscall_desc* desc, int32_t* args)
+{
+  if (!check_args(desc, args)) thread_exit();
 
-  for (char* addr = start; ; addr++)
-  {
-    /* Check if we have changed page */
-    if (current_page != pg_no(addr)) {
-      current_page = pg_no(addr);
-      
-      /* Check that the addr in new page is valid */
-      if (pagedir_get_page(t->pagedir, addr) == NULL) return false;
-    }
+  TRACE(TRACE_SYSCALL_ENTER, args[0], 0);
 
-    /* Check if we have reached the end of the string */
-    if (*addr == '\0') return true;
+  // Counted before the call, since exit and halt never return
+  struct sysstat* s = &stats[args[0]];
+  enum intr_level old_level = intr_disable();
+  s->call_cnt++;
+  intr_set_level(old_level);
+
+  uint64_t start = rdtsc();
+  f->eax = 0;
+  desc->func(f, args);
+  uint64_t cycles = rdtsc() - start;
+
+  old_level = intr_disable();
+  if ((int32_t)f->eax < 0) s->error_cnt++;
+  s->cycles += cycles;
+  s->hist[latency_bucket(cycles)]++;
+  intr_set_level(old_level);
+
+  TRACE(TRACE_SYSCALL_EXIT, args[0], f->eax);
+}
+
+/* Runs system call nr with arguments args, already in the kernel, as
+   if the process had made it directly. Used for operations queued on
+   a submission ring. Returns the result, or -1 if nr can't be queued. */
+int32_t
+syscall_run (int nr, const int32_t args[3])
+{
+  switch (nr)
+  {
+    case SYS_CREATE: case SYS_REMOVE: case SYS_OPEN: case SYS_FILESIZE:
+    case SYS_READ: case SYS_WRITE: case SYS_SEEK: case SYS_TELL:
+    case SYS_CLOSE:
+      break;
+    default:
+      return -1;
   }
+
+  int32_t all_args[5] = { nr, args[0], args[1], args[2], 0 };
+  struct intr_frame f;
+  dispatch(&f, &syscalls[nr], all_args);
+  return f.eax;
 }
 
 static void
 syscall_handler (struct intr_frame *f)
 {
   int32_t* esp = (int32_t*)f->esp;
+  int32_t args[5];
 
-  // Verify syscall number
-  if (!verify_fix_length((void*)esp, 4)) thread_exit();
+  /* Copy the syscall number and then its arguments off the user
+     stack. Pointers among them are checked as they are used. */
+  if (!copy_from_user(&args[0], esp, sizeof args[0])) thread_exit();
 
-  if (esp[0] > SYS_NUMBER_OF_CALLS) thread_exit();
+  if ((uint32_t)args[0] >= SYS_NUMBER_OF_CALLS) thread_exit();
 
-  // Verify arguments
-  if (!verify_fix_length((void*)esp + 4, argc[esp[0]] * 4)) thread_exit();
-
-  // Verify variable length pointer
-  if ((esp[0] == SYS_EXEC || esp[0] == SYS_CREATE || esp[0] == SYS_REMOVE || esp[0] == SYS_OPEN) && !verify_variable_length(esp[1]))
-    thread_exit();
-
-  // Verify fixed length pointer
-  if ((esp[0] == SYS_READ || esp[0] == SYS_WRITE) && !verify_fix_length(esp[2], esp[3]))
-    thread_exit();
-
-  switch ( esp[0] )
+  const struct syscall_desc* desc = &syscalls[args[0]];
+  if (desc->func == NULL)
   {
-    case SYS_HALT: power_off (); break;
-    case SYS_EXIT: exit (esp); break;
-    case SYS_CREATE: create (f, esp); break;
-    case SYS_REMOVE: remove (f, esp); break;
-    case SYS_OPEN: open (f, esp); break;
-    case SYS_CLOSE: close (esp); break;
-    case SYS_READ: read (f, esp); break;
-    case SYS_WRITE: write (f, esp); break;
-    case SYS_FILESIZE: filesize (f, esp); break;
-    case SYS_SEEK: seek (esp); break;
-    case SYS_TELL: tell (f, esp); break;
-    case SYS_SLEEP: sleep (esp); break;
-    case SYS_PLIST: plist (); break;
-    case SYS_EXEC: exec (f, esp); break;
-    case SYS_WAIT: wait (f, esp); break;
-    default:
-    {
-      printf ("Executed an unknown system call!\n");
+    printf ("Executed an unknown system call!\n");
 
-      printf ("Stack top + 0: %d\n", esp[0]);
-      printf ("Stack top + 1: %d\n", esp[1]);
+    printf ("Stack top + 0: %d\n", args[0]);
 
-      thread_exit ();
-    }
+    thread_exit ();
   }
+
+  if (!copy_from_user(&args[1], esp + 1, desc->argc * sizeof args[0])) thread_exit();
+
+  dispatch(f, desc, args);
 }
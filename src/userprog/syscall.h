@@ -1,6 +1,9 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdint.h>
+
 void syscall_init (void);
+int32_t syscall_run (int nr, const int32_t args[3]);
 
 #endif /* userprog/syscall.h */
@@ -0,0 +1,123 @@
+#include "userprog/uaccess.h"
+#include "threads/vaddr.h"
+
+/* An entry in the exception table: if the instruction at INSN
+   faults on a user address, execution goes on at FIXUP.
+
+   Every instruction below that touches user memory adds an entry
+   to the __ex_table section, which kernel.lds.S collects between
+   _start_ex_table and _end_ex_table.  Recovery code that is only
+   run after a fault goes into .fixup, out of the way of the
+   common path. */
+struct ex_entry
+  {
+    uintptr_t insn;             /* Address of the faulting instruction. */
+    uintptr_t fixup;            /* Where to resume. */
+  };
+
+extern const struct ex_entry _start_ex_table[], _end_ex_table[];
+
+static bool is_user_range (const void *, size_t);
+static size_t copy_user (void *dst, const void *src, size_t size);
+static bool get_user_byte (char *dst, const char *usrc);
+
+/* Copies SIZE bytes from user address USRC to DST.  Returns true
+   if successful, false if some byte of USRC is not readable by
+   the user process. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  return is_user_range (usrc, size) && copy_user (dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns true
+   if successful, false if some byte of UDST is not writable by
+   the user process. */
+bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  return is_user_range (udst, size) && copy_user (udst, src, size) == 0;
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes.  Returns the length of the
+   string, or SIZE if it does not fit, in which case DST is not
+   null-terminated.  Returns -1 if the string is not readable by
+   the user process. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    {
+      if (!is_user_vaddr (usrc + i) || !get_user_byte (dst + i, usrc + i))
+        return -1;
+      if (dst[i] == '\0')
+        return i;
+    }
+  return size;
+}
+
+/* Returns the address to resume at if the instruction at EIP
+   faults on a user address, or 0 if EIP is not allowed to
+   fault. */
+uintptr_t
+uaccess_fixup (uintptr_t eip)
+{
+  const struct ex_entry *e;
+
+  for (e = _start_ex_table; e < _end_ex_table; e++)
+    if (e->insn == eip)
+      return e->fixup;
+  return 0;
+}
+
+/* Returns true if the SIZE bytes at UADDR lie entirely below
+   PHYS_BASE.  Whether they are mapped is found out by touching
+   them. */
+static bool
+is_user_range (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+
+  return start + size >= start && start + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Copies SIZE bytes from SRC to DST and returns the number of
+   bytes not copied, which is nonzero only after a fault.  A
+   fault leaves the remaining count in ECX, and the fixup resumes
+   right after the copy. */
+static size_t
+copy_user (void *dst, const void *src, size_t size)
+{
+  asm volatile ("1: rep movsb\n"
+                "2:\n"
+                ".section __ex_table, \"a\"\n"
+                "   .long 1b, 2b\n"
+                ".previous"
+                : "+D" (dst), "+S" (src), "+c" (size) : : "memory");
+  return size;
+}
+
+/* Copies the byte at user address USRC to DST.  Returns true if
+   successful, false if USRC is not readable. */
+static bool
+get_user_byte (char *dst, const char *usrc)
+{
+  int ok = 1;
+  char c;
+
+  asm volatile ("1: movb %2, %1\n"
+                "2:\n"
+                ".section .fixup, \"ax\"\n"
+                "3: movl $0, %0\n"
+                "   jmp 2b\n"
+                ".previous\n"
+                ".section __ex_table, \"a\"\n"
+                "   .long 1b, 3b\n"
+                ".previous"
+                : "+r" (ok), "=q" (c) : "m" (*usrc));
+  *dst = c;
+  return ok;
+}
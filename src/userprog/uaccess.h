@@ -0,0 +1,21 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Copying between kernel and user memory.
+
+   These access user memory directly instead of looking up every
+   page first.  An access to an unmapped or read-only user page
+   faults, and page_fault() resumes at a recovery address found
+   in the exception table, so the copy just fails. */
+
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
+int strncpy_from_user (char *dst, const char *usrc, size_t size);
+
+uintptr_t uaccess_fixup (uintptr_t eip);
+
+#endif /* userprog/uaccess.h */